@@ -5,24 +5,48 @@
 
 ret=0
 
-for x in tests/*/*/; do
-    echo -n "Testing: ${x}"
+# Configure and build a test directory, any further arguments are passed to configure
+run_test() {
+    local x="$1"
+    shift
+    echo -n "Testing: ${x} $*"
     tdir=`mktemp -d`
-    build/src/meson++ configure "${tdir}" --source-dir "${x}" 1>/dev/null
+    build/src/meson++ configure "${tdir}" --source-dir "${x}" "$@" 1>/dev/null
     if [ $? != 0 ]; then
         echo " - FAILED"
         rm -rf "${tdir}"
         ret=1
-        continue
+        return
     fi
     ninja -C "${tdir}" 1>/dev/null
     if [ $? != 0 ]; then
         echo " - FAILED"
         rm -rf "${tdir}"
         ret=1
-        continue
+        return
     fi
+    rm -rf "${tdir}"
     echo " - SUCCESS"
+}
+
+for x in tests/*/*/; do
+    run_test "${x}"
 done
 
+# Every compile, archive, and link goes through a response file
+run_test "tests/dsl/04 link static and exe/" -Dbackend_rsp_threshold=0
+
+# An invalid threshold must fail to configure
+echo -n "Testing: invalid backend_rsp_threshold"
+tdir=`mktemp -d`
+build/src/meson++ configure "${tdir}" --source-dir "tests/dsl/02 trivial/" \
+    -Dbackend_rsp_threshold=abc 1>/dev/null 2>&1
+if [ $? == 0 ]; then
+    echo " - FAILED"
+    ret=1
+else
+    echo " - SUCCESS"
+fi
+rm -rf "${tdir}"
+
 exit $ret
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
 #include <variant>
 #include <vector>
@@ -20,6 +21,19 @@ enum class TargetType {
     CUSTOM,
 };
 
+/**
+ * Arguments shared by all of the edges of a build target
+ *
+ * These are written once, and referenced by each edge, instead of being
+ * repeated for every source.
+ */
+struct SharedArguments {
+    /// The name of the target these are for, which may not be unique
+    std::string target;
+
+    std::vector<std::string> arguments;
+};
+
 /**
  * A Ninja rule to be generated later
  */
@@ -41,6 +55,13 @@ class Target {
            const std::vector<std::string> & o)
         : input{in}, output{out}, type{r}, lang{l}, machine{m}, arguments{args}, deps{d},
           order_deps{o} {};
+    Target(const std::vector<std::string> & in, const std::string & out, const TargetType & r,
+           const MIR::Toolchain::Language & l, const MIR::Machines::Machine & m,
+           const std::shared_ptr<const SharedArguments> & shared,
+           const std::vector<std::string> & args, const std::vector<std::string> & d,
+           const std::vector<std::string> & o)
+        : input{in}, output{out}, type{r}, lang{l}, machine{m}, shared_arguments{shared},
+          arguments{args}, deps{d}, order_deps{o} {};
     Target(const std::vector<std::string> & in, const std::vector<std::string> & out,
            const TargetType & r, const std::vector<std::string> & a)
         : input{in}, output{out}, type{r}, lang{}, machine{}, arguments{a}, deps{}, order_deps{} {};
@@ -60,6 +81,9 @@ class Target {
     /// The machine of this rule
     const MIR::Machines::Machine machine;
 
+    /// Arguments shared with other rules of the same target, which come first
+    const std::shared_ptr<const SharedArguments> shared_arguments;
+
     /// The arguments for this rule
     const std::vector<std::string> arguments;
 
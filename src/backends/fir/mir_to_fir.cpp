@@ -2,13 +2,15 @@
 // Copyright © 2021 Intel Corporation
 
 #include "fir.hpp"
+#include "thread_pool.hpp"
 
 namespace Backends::FIR {
 
 namespace {
 
 template <typename T>
-std::vector<Target> target_rule(const T & e, const MIR::State::Persistant & pstate) {
+std::vector<Target> target_rule(const T & e, const MIR::State::Persistant & pstate,
+                                Util::RelativePaths & paths) {
     static_assert(std::is_base_of<MIR::Executable, T>::value ||
                       std::is_base_of<MIR::StaticLibrary, T>::value,
                   "Must be derived from a build target");
@@ -17,8 +19,8 @@ std::vector<Target> target_rule(const T & e, const MIR::State::Persistant & psta
     if (e.arguments.find(MIR::Toolchain::Language::CPP) != e.arguments.end()) {
         const auto & tc = pstate.toolchains.at(MIR::Toolchain::Language::CPP);
         for (const auto & a : e.arguments.at(MIR::Toolchain::Language::CPP)) {
-            const auto & args =
-                tc.build()->compiler->specialize_argument(a, pstate.source_root, pstate.build_root);
+            const auto & args = tc.build()->compiler->specialize_argument(
+                a, pstate.source_root, pstate.build_root, paths);
             for (const auto & arg : args) {
                 cpp_args.emplace_back(arg);
             }
@@ -28,17 +30,21 @@ std::vector<Target> target_rule(const T & e, const MIR::State::Persistant & psta
     std::vector<Target> rules{};
     const auto & tc = pstate.toolchains.at(MIR::Toolchain::Language::CPP);
 
-    // These are the same on each iteration
-    const auto & always_args = tc.build()->compiler->always_args();
-
     // TODO: there's a keyword argument to control this
     auto lincs = tc.build()->compiler->specialize_argument(
         MIR::Arguments::Argument(e.subdir, MIR::Arguments::Type::INCLUDE), pstate.source_root,
-        pstate.build_root);
+        pstate.build_root, paths);
     for (const auto & arg : lincs) {
         cpp_args.emplace_back(arg);
     }
 
+    // These are the same for every source, so they're shared by all of the
+    // compile rules rather than copied into each one
+    const auto & always_args = tc.build()->compiler->always_args();
+    cpp_args.insert(cpp_args.end(), always_args.begin(), always_args.end());
+    const auto lang_args =
+        std::make_shared<const SharedArguments>(SharedArguments{e.name, std::move(cpp_args)});
+
     std::vector<std::string> order_deps{};
     for (const auto & f : e.sources) {
         if (std::holds_alternative<std::shared_ptr<MIR::CustomTarget>>(f)) {
@@ -59,9 +65,6 @@ std::vector<Target> target_rule(const T & e, const MIR::State::Persistant & psta
         // TODO: actually set args to something
         // TODO: do something better for private dirs, we really need the subdir for this
 
-        auto lang_args = cpp_args;
-        lang_args.insert(lang_args.end(), always_args.begin(), always_args.end());
-
         // FIXME: without depfile support, we can't really treat order only deps
         // correctly, and instead we have to treat them as full deps for correct
         // behavior. This should be fixed.
@@ -77,6 +80,7 @@ std::vector<Target> target_rule(const T & e, const MIR::State::Persistant & psta
                            MIR::Machines::Machine::BUILD,
                            lang_args,
                            {},
+                           {},
                            order_deps});
             }
         } else {
@@ -91,6 +95,7 @@ std::vector<Target> target_rule(const T & e, const MIR::State::Persistant & psta
                                MIR::Toolchain::Language::CPP,
                                MIR::Machines::Machine::BUILD,
                                lang_args,
+                               {},
                                {ff.relative_to_build_dir()},
                                order_deps});
                 }
@@ -118,10 +123,25 @@ std::vector<Target> target_rule(const T & e, const MIR::State::Persistant & psta
     } else {
         type = TargetType::LINK;
         name = e.output();
-        link_args = tc.build()->linker->always_args();
-    }
+        // The linker's always_args are written once, in the link rule
 
-    // TODO: linker/archiver always_args
+        // Static libraries can't carry their dependencies' libraries, so
+        // they have to be passed when linking whatever uses them
+        std::vector<const MIR::Arguments::Argument *> dep_args{};
+        for (const auto & a : e.link_arguments) {
+            dep_args.emplace_back(&a);
+        }
+        for (const auto & [_, l] : e.link_static) {
+            for (const auto & a : l->link_arguments) {
+                dep_args.emplace_back(&a);
+            }
+        }
+        for (const auto & a : dep_args) {
+            const auto & args = tc.build()->compiler->specialize_argument(
+                *a, pstate.source_root, pstate.build_root, paths);
+            link_args.insert(link_args.end(), args.begin(), args.end());
+        }
+    }
 
     rules.emplace_back(Target{
         final_outs,
@@ -137,7 +157,8 @@ std::vector<Target> target_rule(const T & e, const MIR::State::Persistant & psta
 
 template <>
 std::vector<Target> target_rule<MIR::CustomTarget>(const MIR::CustomTarget & e,
-                                                   const MIR::State::Persistant & pstate) {
+                                                   const MIR::State::Persistant &,
+                                                   Util::RelativePaths &) {
     std::vector<std::string> outs{};
     for (const auto & o : e.outputs) {
         outs.emplace_back(o.relative_to_build_dir());
@@ -163,20 +184,40 @@ std::vector<Target> target_rule<MIR::CustomTarget>(const MIR::CustomTarget & e,
 
 std::vector<Target> mir_to_fir(const MIR::BasicBlock * const block,
                                const MIR::State::Persistant & pstate) {
-    // A list of all rules
-    std::vector<Target> rules{};
-
+    std::vector<const MIR::Object *> targets{};
     for (const auto & i : block->instructions) {
+        if (std::holds_alternative<std::shared_ptr<MIR::Executable>>(i) ||
+            std::holds_alternative<std::shared_ptr<MIR::StaticLibrary>>(i) ||
+            std::holds_alternative<std::shared_ptr<MIR::CustomTarget>>(i)) {
+            targets.emplace_back(&i);
+        }
+    }
+
+    // Targets mostly use the same include directories, relative to the same
+    // build directory
+    Util::RelativePaths paths{};
+
+    // Each target is converted independently, and the results are put back
+    // together in the order the targets were defined
+    std::vector<std::vector<Target>> converted(targets.size());
+    Util::pool().parallel_for(targets.size(), [&](std::size_t n) {
+        const auto & i = *targets[n];
         if (std::holds_alternative<std::shared_ptr<MIR::Executable>>(i)) {
-            auto r = target_rule(*std::get<std::shared_ptr<MIR::Executable>>(i), pstate);
-            std::move(r.begin(), r.end(), std::back_inserter(rules));
+            converted[n] =
+                target_rule(*std::get<std::shared_ptr<MIR::Executable>>(i), pstate, paths);
         } else if (std::holds_alternative<std::shared_ptr<MIR::StaticLibrary>>(i)) {
-            auto r = target_rule(*std::get<std::shared_ptr<MIR::StaticLibrary>>(i), pstate);
-            std::move(r.begin(), r.end(), std::back_inserter(rules));
-        } else if (std::holds_alternative<std::shared_ptr<MIR::CustomTarget>>(i)) {
-            auto r = target_rule(*std::get<std::shared_ptr<MIR::CustomTarget>>(i), pstate);
-            std::move(r.begin(), r.end(), std::back_inserter(rules));
+            converted[n] =
+                target_rule(*std::get<std::shared_ptr<MIR::StaticLibrary>>(i), pstate, paths);
+        } else {
+            converted[n] =
+                target_rule(*std::get<std::shared_ptr<MIR::CustomTarget>>(i), pstate, paths);
         }
+    });
+
+    // A list of all rules
+    std::vector<Target> rules{};
+    for (auto & r : converted) {
+        std::move(r.begin(), r.end(), std::back_inserter(rules));
     }
 
     return rules;
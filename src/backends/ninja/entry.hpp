@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <vector>
+
+#include "fir/fir.hpp"
 #include "meson/state/state.hpp"
 #include "mir.hpp"
 
@@ -17,4 +20,12 @@ namespace Backends::Ninja {
  */
 void generate(const MIR::BasicBlock * const, const MIR::State::Persistant &);
 
+/**
+ * Writes the ninja file for already lowered targets
+ *
+ * The file is replaced atomically, so a failure part way through leaves the
+ * previous build.ninja in place.
+ */
+void write(const std::vector<FIR::Target> &, const MIR::State::Persistant &);
+
 } // namespace Backends::Ninja
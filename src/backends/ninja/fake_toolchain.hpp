@@ -0,0 +1,38 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+/**
+ * A toolchain for the ninja test and benchmark, which never runs anything
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "meson/state/state.hpp"
+#include "toolchains/archiver.hpp"
+#include "toolchains/compilers/cpp/cpp.hpp"
+#include "toolchains/linker.hpp"
+
+namespace Backends::Ninja {
+
+/**
+ * Add a GNU C++ toolchain for the build machine, without detecting one
+ *
+ * The compiler and linker are `c++`, and the archiver is `ar`.
+ */
+inline void add_fake_toolchain(MIR::State::Persistant & pstate) {
+    const std::vector<std::string> cmd{"c++"};
+    auto comp = std::make_unique<MIR::Toolchain::Compiler::CPP::Gnu>(cmd);
+    auto linker = std::make_unique<MIR::Toolchain::Linker::Drivers::Gnu>(
+        std::make_unique<MIR::Toolchain::Linker::GnuBFD>(cmd), comp.get());
+    pstate.toolchains[MIR::Toolchain::Language::CPP] =
+        MIR::Machines::PerMachine<std::shared_ptr<MIR::Toolchain::Toolchain>>{
+            std::make_shared<MIR::Toolchain::Toolchain>(
+                std::move(comp), std::move(linker),
+                std::make_unique<MIR::Toolchain::Archiver::Gnu>(std::vector<std::string>{"ar"}))};
+}
+
+} // namespace Backends::Ninja
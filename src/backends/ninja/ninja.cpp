@@ -6,16 +6,24 @@
  */
 
 #include <algorithm>
+#include <cctype>
 #include <cerrno>
 #include <filesystem>
-#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <variant>
 #include <vector>
 
 #include "entry.hpp"
 #include "exceptions.hpp"
 #include "fir/fir.hpp"
+#include "thread_pool.hpp"
 #include "toolchains/compiler.hpp"
+#include "writer.hpp"
 
 namespace fs = std::filesystem;
 
@@ -23,13 +31,79 @@ namespace Backends::Ninja {
 
 namespace {
 
+/// The number of build edges formatted by a single job
+constexpr std::size_t CHUNK_SIZE = 256;
+
+/// Appended to the name of a rule that passes it's inputs in a response file
+constexpr std::string_view RSP_SUFFIX = "_RSP";
+
+/**
+ * Default length of a command that is moved into a response file
+ *
+ * Ninja runs each command with `/bin/sh -c`, so the whole command is a single
+ * argument, which Linux limits to 128KiB. This leaves half of that for the
+ * rest of the command, and for the estimate being short.
+ */
+constexpr std::size_t RSP_THRESHOLD = 64 * 1024;
+
+/// Which rules have a response file variant, and when it's used
+struct ResponseFiles {
+    bool compile = false;
+    bool link = false;
+    bool archive = false;
+    std::size_t threshold = RSP_THRESHOLD;
+};
+
+/// Get the response file threshold from `-Dbackend_rsp_threshold`, or the default
+std::size_t rsp_threshold(const MIR::State::Persistant & pstate) {
+    const auto opt = pstate.options.find("backend_rsp_threshold");
+    if (opt == pstate.options.end()) {
+        return RSP_THRESHOLD;
+    }
+    const std::string & value = opt->second;
+    if (!value.empty() && std::all_of(value.begin(), value.end(),
+                                      [](unsigned char c) { return std::isdigit(c); })) {
+        try {
+            return std::stoull(value);
+        } catch (const std::out_of_range &) {
+        }
+    }
+    throw Util::Exceptions::InvalidArguments(
+        "backend_rsp_threshold must be a non-negative integer, not \"" + value + "\"");
+}
+
+/**
+ * Estimate how long the command for an edge will be
+ *
+ * This is the length of the inputs and arguments, which is what grows with the
+ * size of a target, the rest of the command is short. Ninja expands the
+ * variables holding the arguments into the command, so they count too.
+ */
+std::size_t command_length(const FIR::Target & rule) {
+    std::size_t length = 0;
+    for (const auto & i : rule.input) {
+        length += i.size() + 1;
+    }
+    std::size_t args = 0;
+    if (rule.shared_arguments != nullptr) {
+        for (const auto & a : rule.shared_arguments->arguments) {
+            args += a.size() + 1;
+        }
+    }
+    for (const auto & a : rule.arguments) {
+        args += a.size() + 1;
+    }
+    // Link commands have the arguments both before and after the inputs
+    return length + args * (rule.type == FIR::TargetType::LINK ? 2 : 1);
+}
+
 void write_compiler_rule(const std::string & lang,
                          const std::unique_ptr<MIR::Toolchain::Compiler::Compiler> & c,
-                         std::ofstream & out) {
+                         Util::FileWriter & out) {
 
     // TODO: build or host correctly
     out << "rule " << lang << "_compiler_for_"
-        << "build" << std::endl;
+        << "build\n";
 
     // Write the command
     // TODO: write the depfile stuff
@@ -48,26 +122,54 @@ void write_compiler_rule(const std::string & lang,
     for (const auto & a : c->compile_only_command()) {
         out << " " << a;
     }
-    out << " ${in}" << std::endl;
+    out << " ${in}\n";
 
     // TODO: control support for this
     // TODO: MSVC style deps
     // FIXME: why does meson write this out with two different vlues?
-    out << "  deps = gcc" << std::endl;
-    out << "  depfile = $DEPFILE_UNQUOTED" << std::endl;
+    out << "  deps = gcc\n";
+    out << "  depfile = $DEPFILE_UNQUOTED\n";
 
     // Write the description
-    out << "  description = Compiling " << c->language() << " object ${out}" << std::endl
-        << std::endl;
+    out << "  description = Compiling " << c->language() << " object ${out}\n\n";
+
+    if (c->rsp_support() != MIR::Toolchain::RSPFileSupport::GCC) {
+        return;
+    }
+
+    // Only the arguments and the source go in the response file, the output
+    // and depfile stay on the command line
+    out << "rule " << lang << "_compiler_for_"
+        << "build" << RSP_SUFFIX << "\n";
+    out << "  command =";
+    for (const auto & c : c->command) {
+        out << " " << c;
+    }
+    out << " @${out}.rsp";
+    for (const auto & a : c->generate_depfile("${out}", "$DEPFILE")) {
+        out << " " << a;
+    }
+    for (const auto & a : c->output_command("${out}")) {
+        out << " " << a;
+    }
+    for (const auto & a : c->compile_only_command()) {
+        out << " " << a;
+    }
+    out << "\n";
+    out << "  rspfile = ${out}.rsp\n";
+    out << "  rspfile_content = ${ARGS} ${in}\n";
+    out << "  deps = gcc\n";
+    out << "  depfile = $DEPFILE_UNQUOTED\n";
+    out << "  description = Compiling " << c->language() << " object ${out}\n\n";
 }
 
 void write_archiver_rule(const std::string & lang,
                          const std::unique_ptr<MIR::Toolchain::Archiver::Archiver> & c,
-                         std::ofstream & out) {
+                         Util::FileWriter & out) {
 
     // TODO: build or host correctly
     out << "rule " << lang << "_archiver_for_"
-        << "build" << std::endl;
+        << "build\n";
 
     // Write the command
     // TODO: write the depfile stuff
@@ -79,16 +181,32 @@ void write_archiver_rule(const std::string & lang,
     out << " ${ARGS} ${out} ${in}\n";
 
     // Write the description
-    out << "  description = Linking Static target ${out}\n" << std::endl;
+    out << "  description = Linking Static target ${out}\n\n";
+
+    if (c->rsp_support() != MIR::Toolchain::RSPFileSupport::GCC) {
+        return;
+    }
+
+    out << "rule " << lang << "_archiver_for_"
+        << "build" << RSP_SUFFIX << "\n";
+    out << "  command =";
+    out << "rm -f ${out} &&";
+    for (const auto & c : c->command()) {
+        out << " " << c;
+    }
+    out << " ${ARGS} ${out} @${out}.rsp\n";
+    out << "  rspfile = ${out}.rsp\n";
+    out << "  rspfile_content = ${in}\n";
+    out << "  description = Linking Static target ${out}\n\n";
 }
 
 void write_linker_rule(const std::string & lang,
                        const std::unique_ptr<MIR::Toolchain::Linker::Linker> & c,
-                       std::ofstream & out) {
+                       Util::FileWriter & out) {
 
     // TODO: build or host correctly
     out << "rule " << lang << "_linker_for_"
-        << "build" << std::endl;
+        << "build\n";
 
     // Write the command
     // TODO: write the depfile stuff
@@ -96,14 +214,40 @@ void write_linker_rule(const std::string & lang,
     for (const auto & c : c->command()) {
         out << " " << c;
     }
+    for (const auto & a : c->always_args()) {
+        out << " " << a;
+    }
     out << " ${ARGS}";
     for (const auto & c : c->output_command("${out}")) {
         out << " " << c;
     }
-    out << " ${in} ${ARGS}" << std::endl;
+    out << " ${in} ${ARGS}\n";
 
     // Write the description
-    out << "  description = Linking target ${out}" << std::endl << std::endl;
+    out << "  description = Linking target ${out}\n\n";
+
+    if (c->rsp_support() != MIR::Toolchain::RSPFileSupport::GCC) {
+        return;
+    }
+
+    // The compiler driver expands the response file itself, and passes the
+    // arguments on to the linker in the same order
+    out << "rule " << lang << "_linker_for_"
+        << "build" << RSP_SUFFIX << "\n";
+    out << "  command =";
+    for (const auto & c : c->command()) {
+        out << " " << c;
+    }
+    for (const auto & a : c->always_args()) {
+        out << " " << a;
+    }
+    for (const auto & c : c->output_command("${out}")) {
+        out << " " << c;
+    }
+    out << " @${out}.rsp\n";
+    out << "  rspfile = ${out}.rsp\n";
+    out << "  rspfile_content = ${ARGS} ${in} ${ARGS}\n";
+    out << "  description = Linking target ${out}\n\n";
 }
 
 std::string escape(const std::string & str, const bool & quote = false) {
@@ -124,7 +268,72 @@ std::string escape(const std::string & str, const bool & quote = false) {
     return new_s;
 }
 
-void write_build_rule(const FIR::Target & rule, std::ofstream & out) {
+/// Part of the file, formatted on a worker thread
+class Buffer {
+  public:
+    Buffer & operator<<(std::string_view str) {
+        text.append(str);
+        return *this;
+    }
+    Buffer & operator<<(char c) {
+        text.push_back(c);
+        return *this;
+    }
+
+    std::string text;
+};
+
+/**
+ * Names for the variables holding arguments shared by the rules of a target
+ *
+ * Names are handed out in the order rules are written, so that they don't
+ * depend on which thread formats which rule.
+ */
+class SharedVariables {
+  public:
+    /// Get the name of the variable for some arguments, and whether this is it's first use
+    std::pair<const std::string *, bool> get(const FIR::SharedArguments & shared) {
+        if (auto it = names.find(&shared); it != names.end()) {
+            return {&it->second, false};
+        }
+
+        // Target names may have characters that aren't valid in a variable
+        std::string name = "ARGS_";
+        for (const auto & c : shared.target) {
+            name.push_back(std::isalnum(static_cast<unsigned char>(c)) ? c : '_');
+        }
+        if (!used.emplace(name).second) {
+            std::size_t i = 1;
+            while (!used.emplace(name + "_" + std::to_string(i)).second) {
+                ++i;
+            }
+            name += "_" + std::to_string(i);
+        }
+
+        return {&names.emplace(&shared, std::move(name)).first->second, true};
+    }
+
+  private:
+    std::unordered_map<const FIR::SharedArguments *, std::string> names;
+    std::unordered_set<std::string> used;
+};
+
+/**
+ * Write a build edge
+ *
+ * @param shared_name The variable holding the rule's shared arguments, if it has any
+ * @param define Whether the shared variable needs to be defined before this edge
+ */
+void write_build_rule(const FIR::Target & rule, const std::string * shared_name,
+                      const bool & define, const ResponseFiles & rsp, Buffer & out) {
+    if (define) {
+        out << *shared_name << " =";
+        for (const auto & a : rule.shared_arguments->arguments) {
+            out << " " << escape(a, true);
+        }
+        out << "\n\n";
+    }
+
     // TODO: get the actual compiler/linker
     std::string rule_name;
     switch (rule.type) {
@@ -144,6 +353,13 @@ void write_build_rule(const FIR::Target & rule, std::ofstream & out) {
             throw std::exception{}; // should be unreachable
     }
 
+    const bool has_rsp = (rule.type == FIR::TargetType::COMPILE && rsp.compile) ||
+                         (rule.type == FIR::TargetType::LINK && rsp.link) ||
+                         (rule.type == FIR::TargetType::ARCHIVE && rsp.archive);
+    if (has_rsp && command_length(rule) > rsp.threshold) {
+        rule_name += RSP_SUFFIX;
+    }
+
     out << "build";
     for (const auto & o : rule.output) {
         out << " " << escape(o);
@@ -170,6 +386,9 @@ void write_build_rule(const FIR::Target & rule, std::ofstream & out) {
     out << "\n";
 
     out << "  ARGS =";
+    if (shared_name != nullptr) {
+        out << " ${" << *shared_name << "}";
+    }
     for (const auto & a : rule.arguments) {
         out << " " << escape(a, true);
     }
@@ -178,15 +397,15 @@ void write_build_rule(const FIR::Target & rule, std::ofstream & out) {
     // Write the depfile
     // TODO: better control of when to do this
     if (rule.type == FIR::TargetType::COMPILE) {
-        out << "  DEPFILE = " << escape(rule.output[0]) << ".d" << std::endl;
-        out << "  DEPFILE_UNQUOTED = " << rule.output[0] << ".d" << std::endl;
+        out << "  DEPFILE = " << escape(rule.output[0]) << ".d\n";
+        out << "  DEPFILE_UNQUOTED = " << rule.output[0] << ".d\n";
     }
 
     if (rule.type == FIR::TargetType::CUSTOM) {
         out << "  DESCRIPTION = " << escape("generating ") << escape(rule.output[0])
             << escape(" with ") << escape(rule.arguments[0]) << "\n";
     }
-    out << std::endl;
+    out << '\n';
 }
 
 } // namespace
@@ -211,16 +430,18 @@ void generate(const MIR::BasicBlock * const block, const MIR::State::Persistant
         }
     }
 
-    std::ofstream out{};
-    out.open(pstate.build_root / "build.ninja", std::ios::out | std::ios::trunc);
-    out << "# This is a build file for the project \"" << pstate.name << "\"." << std::endl
-        << "# It is autogenerated by the Meson++ build system." << std::endl
-        << "# Do not edit by hand." << std::endl
-        << std::endl
-        << "ninja_required_version = 1.8.2" << std::endl
-        << std::endl;
+    const auto & rules = FIR::mir_to_fir(block, pstate);
+    write(rules, pstate);
+}
+
+void write(const std::vector<FIR::Target> & rules, const MIR::State::Persistant & pstate) {
+    Util::FileWriter out{pstate.build_root / "build.ninja"};
+    out << "# This is a build file for the project \"" << pstate.name << "\".\n"
+        << "# It is autogenerated by the Meson++ build system.\n"
+        << "# Do not edit by hand.\n\n"
+        << "ninja_required_version = 1.8.2\n\n";
 
-    out << "# Compilation rules" << std::endl << std::endl;
+    out << "# Compilation rules\n\n";
 
     for (const auto & [l, tc] : pstate.toolchains) {
         const auto & lstr = MIR::Toolchain::to_string(l);
@@ -228,7 +449,7 @@ void generate(const MIR::BasicBlock * const block, const MIR::State::Persistant
         write_compiler_rule(lstr, tc.build()->compiler, out);
     }
 
-    out << "# Static Linking rules" << std::endl << std::endl;
+    out << "# Static Linking rules\n\n";
 
     for (const auto & [l, tc] : pstate.toolchains) {
         const auto & lstr = MIR::Toolchain::to_string(l);
@@ -236,7 +457,7 @@ void generate(const MIR::BasicBlock * const block, const MIR::State::Persistant
         write_archiver_rule(lstr, tc.build()->archiver, out);
     }
 
-    out << "# Dynamic Linking rules" << std::endl << std::endl;
+    out << "# Dynamic Linking rules\n\n";
 
     for (const auto & [l, tc] : pstate.toolchains) {
         const auto & lstr = MIR::Toolchain::to_string(l);
@@ -244,6 +465,17 @@ void generate(const MIR::BasicBlock * const block, const MIR::State::Persistant
         write_linker_rule(lstr, tc.build()->linker, out);
     }
 
+    // TODO: should also have a _for_host
+    ResponseFiles rsp{};
+    rsp.threshold = rsp_threshold(pstate);
+    if (auto tc = pstate.toolchains.find(MIR::Toolchain::Language::CPP);
+        tc != pstate.toolchains.end()) {
+        const auto & build = tc->second.build();
+        rsp.compile = build->compiler->rsp_support() == MIR::Toolchain::RSPFileSupport::GCC;
+        rsp.link = build->linker->rsp_support() == MIR::Toolchain::RSPFileSupport::GCC;
+        rsp.archive = build->archiver->rsp_support() == MIR::Toolchain::RSPFileSupport::GCC;
+    }
+
     out << "rule custom_command\n"
         << "  command = $ARGS\n"
         << "  description = $DESCRIPTION\n"
@@ -253,13 +485,29 @@ void generate(const MIR::BasicBlock * const block, const MIR::State::Persistant
         << "build PHONY: phony\n\n"
         << "# Build rules for targets\n\n";
 
-    const auto & rules = FIR::mir_to_fir(block, pstate);
-    for (const auto & r : rules) {
-        write_build_rule(r, out);
+    // Which rule defines each shared variable has to be decided in order. The
+    // rules can then be formatted in parallel, in chunks that are written out
+    // in their original order.
+    SharedVariables shared{};
+    std::vector<std::pair<const std::string *, bool>> names(rules.size(), {nullptr, false});
+    for (std::size_t i = 0; i < rules.size(); ++i) {
+        if (rules[i].shared_arguments != nullptr) {
+            names[i] = shared.get(*rules[i].shared_arguments);
+        }
+    }
+
+    std::vector<Buffer> chunks((rules.size() + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    Util::pool().parallel_for(chunks.size(), [&](std::size_t c) {
+        const std::size_t end = std::min(rules.size(), (c + 1) * CHUNK_SIZE);
+        for (std::size_t i = c * CHUNK_SIZE; i < end; ++i) {
+            write_build_rule(rules[i], names[i].first, names[i].second, rsp, chunks[c]);
+        }
+    });
+    for (const auto & c : chunks) {
+        out << c.text;
     }
 
-    out.flush();
-    out.close();
+    out.commit();
 }
 
 } // namespace Backends::Ninja
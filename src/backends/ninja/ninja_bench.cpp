@@ -0,0 +1,111 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+/**
+ * Measure how long it takes to write a build.ninja with many build edges
+ *
+ * The targets are generated, so this only measures emission, not lowering.
+ * Both writing a new file, and regenerating one with the same contents, are
+ * measured.
+ *
+ * usage: ninja_bench [edges] [iterations]
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "entry.hpp"
+#include "fake_toolchain.hpp"
+#include "fir/fir.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/// Sources per target, each target has one link edge as well
+constexpr unsigned SOURCES = 100;
+
+std::vector<Backends::FIR::Target> make_targets(unsigned edges) {
+    // Something like a real target would have, a few defines and a lot of
+    // include directories
+    std::vector<std::string> args{"-DHAVE_CONFIG_H", "-D_FILE_OFFSET_BITS=64", "-O2", "-g"};
+    for (unsigned i = 0; i < 20; ++i) {
+        args.emplace_back("-I../subprojects/dependency" + std::to_string(i) + "/include");
+    }
+
+    std::vector<Backends::FIR::Target> targets{};
+    std::vector<std::string> objects{};
+    std::shared_ptr<const Backends::FIR::SharedArguments> shared{};
+    for (unsigned i = 0; i < edges; ++i) {
+        const std::string target = "target" + std::to_string(i / (SOURCES + 1));
+        if (i % (SOURCES + 1) == 0) {
+            shared = std::make_shared<const Backends::FIR::SharedArguments>(
+                Backends::FIR::SharedArguments{target, args});
+        }
+        if (i % (SOURCES + 1) == SOURCES) {
+            targets.emplace_back(objects, target, Backends::FIR::TargetType::LINK,
+                                 MIR::Toolchain::Language::CPP, MIR::Machines::Machine::BUILD,
+                                 std::vector<std::string>{"-Wl,--as-needed"});
+            objects.clear();
+            continue;
+        }
+        const std::string source = "src/" + target + "/file " + std::to_string(i) + ".cpp";
+        const std::string object = target + ".p/" + source + ".o";
+        targets.emplace_back(std::vector<std::string>{"../" + source}, object,
+                             Backends::FIR::TargetType::COMPILE, MIR::Toolchain::Language::CPP,
+                             MIR::Machines::Machine::BUILD, shared,
+                             std::vector<std::string>{}, std::vector<std::string>{},
+                             std::vector<std::string>{});
+        objects.emplace_back(object);
+    }
+    return targets;
+}
+
+} // namespace
+
+int main(int argc, char * argv[]) {
+    const unsigned edges = argc > 1 ? std::stoul(argv[1]) : 50000;
+    const unsigned iterations = argc > 2 ? std::stoul(argv[2]) : 10;
+
+    const fs::path root = fs::temp_directory_path() / ("ninja_bench_" + std::to_string(getpid()));
+    fs::create_directories(root);
+
+    MIR::State::Persistant pstate{root, root};
+    pstate.name = "bench";
+    Backends::Ninja::add_fake_toolchain(pstate);
+
+    const auto targets = make_targets(edges);
+
+    // Writing a new file, and regenerating one that hasn't changed, which is
+    // compared instead of written
+    std::array<double, 2> best{};
+    std::array<double, 2> total{};
+    for (unsigned i = 0; i < iterations; ++i) {
+        for (std::size_t unchanged = 0; unchanged < 2; ++unchanged) {
+            if (!unchanged) {
+                fs::remove(root / "build.ninja");
+            }
+            const auto start = std::chrono::steady_clock::now();
+            Backends::Ninja::write(targets, pstate);
+            const std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - start;
+            total[unchanged] += elapsed.count();
+            best[unchanged] = i == 0 ? elapsed.count() : std::min(best[unchanged], elapsed.count());
+        }
+    }
+
+    std::cout << "edges\tsize (KiB)\tnew best/mean (ms)\tunchanged best/mean (ms)" << std::endl;
+    std::cout << targets.size() << '\t' << fs::file_size(root / "build.ninja") / 1024 << "\t\t"
+              << best[0] << " / " << total[0] / iterations << "\t\t" << best[1] << " / "
+              << total[1] / iterations << std::endl;
+
+    fs::remove_all(root);
+    return 0;
+}
@@ -0,0 +1,95 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "entry.hpp"
+#include "exceptions.hpp"
+#include "fake_toolchain.hpp"
+#include "fir/fir.hpp"
+#include "test_directory.hpp"
+
+namespace fs = std::filesystem;
+namespace FIR = Backends::FIR;
+
+namespace {
+
+class NinjaTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        pstate = std::make_unique<MIR::State::Persistant>(root, root);
+        pstate->name = "test";
+        Backends::Ninja::add_fake_toolchain(*pstate);
+
+        // A library, and an executable linking it
+        const std::vector<std::string> args{"-I../include"};
+        targets.emplace_back(std::vector<std::string>{"../lib.cpp"}, "lib.o",
+                             FIR::TargetType::COMPILE, MIR::Toolchain::Language::CPP,
+                             MIR::Machines::Machine::BUILD, args);
+        targets.emplace_back(std::vector<std::string>{"lib.o"}, "liblib.a",
+                             FIR::TargetType::ARCHIVE, MIR::Toolchain::Language::CPP,
+                             MIR::Machines::Machine::BUILD, std::vector<std::string>{"csrD"});
+        targets.emplace_back(std::vector<std::string>{"../main.cpp"}, "main.o",
+                             FIR::TargetType::COMPILE, MIR::Toolchain::Language::CPP,
+                             MIR::Machines::Machine::BUILD, args);
+        targets.emplace_back(std::vector<std::string>{"main.o", "liblib.a"}, "main",
+                             FIR::TargetType::LINK, MIR::Toolchain::Language::CPP,
+                             MIR::Machines::Machine::BUILD, std::vector<std::string>{});
+    }
+
+    std::string read() const {
+        std::ifstream in{root / "build.ninja"};
+        std::stringstream ss{};
+        ss << in.rdbuf();
+        return ss.str();
+    }
+
+    const Util::TestDirectory tmp{};
+    const fs::path & root = tmp.path;
+    std::unique_ptr<MIR::State::Persistant> pstate;
+    std::vector<FIR::Target> targets;
+};
+
+} // namespace
+
+TEST_F(NinjaTest, rsp_default) {
+    Backends::Ninja::write(targets, *pstate);
+    const auto & text = read();
+
+    // The rules are there, but short commands don't use them
+    ASSERT_NE(text.find("rule cpp_compiler_for_build_RSP\n"), std::string::npos);
+    ASSERT_NE(text.find("rule cpp_archiver_for_build_RSP\n"), std::string::npos);
+    ASSERT_NE(text.find("rule cpp_linker_for_build_RSP\n"), std::string::npos);
+    ASSERT_NE(text.find("build lib.o: cpp_compiler_for_build ../lib.cpp\n"), std::string::npos);
+    ASSERT_NE(text.find("build liblib.a: cpp_archiver_for_build lib.o\n"), std::string::npos);
+    ASSERT_NE(text.find("build main: cpp_linker_for_build main.o liblib.a\n"), std::string::npos);
+}
+
+TEST_F(NinjaTest, rsp_threshold_zero) {
+    pstate->options["backend_rsp_threshold"] = "0";
+    Backends::Ninja::write(targets, *pstate);
+    const auto & text = read();
+
+    ASSERT_NE(text.find("build lib.o: cpp_compiler_for_build_RSP ../lib.cpp\n"),
+              std::string::npos);
+    ASSERT_NE(text.find("build liblib.a: cpp_archiver_for_build_RSP lib.o\n"), std::string::npos);
+    ASSERT_NE(text.find("build main: cpp_linker_for_build_RSP main.o liblib.a\n"),
+              std::string::npos);
+}
+
+TEST_F(NinjaTest, rsp_threshold_invalid) {
+    for (const auto & value : {"abc", "-1", "", "10k"}) {
+        pstate->options["backend_rsp_threshold"] = value;
+        ASSERT_THROW(Backends::Ninja::write(targets, *pstate),
+                     Util::Exceptions::InvalidArguments);
+    }
+    // Nothing is written
+    ASSERT_FALSE(fs::exists(root / "build.ninja"));
+}
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <functional>
 #include <istream>
 #include <memory>
 #include <string>
@@ -21,6 +22,15 @@ class Driver {
     std::unique_ptr<AST::CodeBlock> parse(const std::string &);
 
     std::string name;
+
+    /**
+     * Called with the first statement of the file as soon as it is parsed
+     *
+     * The rest of the file hasn't been parsed yet, so this allows work that
+     * only depends on the `project()` call to start early. It is called at
+     * most once.
+     */
+    std::function<void(const AST::StatementV &)> first_statement;
 };
 
 } // namespace Frontend
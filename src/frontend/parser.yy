@@ -10,6 +10,7 @@
 %define api.location.file "locations.hpp"
 
 %code requires {
+    #include <functional>
     #include <memory>
     #include "node.hpp"
 
@@ -21,6 +22,7 @@
 
 %parse-param { Scanner & scanner }
 %parse-param { std::unique_ptr<AST::CodeBlock> & block }
+%parse-param { std::function<void(const AST::StatementV &)> & first_statement }
 
 %locations
 %initial-action {
@@ -99,7 +101,13 @@ program : %empty                                    { block = std::make_unique<A
         | statements "\n"                           { block = std::move($1); }
         ;
 
-statements : statement                              { $$ = std::make_unique<AST::CodeBlock>(std::move($1)); }
+statements : statement                              {
+                                                        if (first_statement) {
+                                                            first_statement($1);
+                                                            first_statement = nullptr;
+                                                        }
+                                                        $$ = std::make_unique<AST::CodeBlock>(std::move($1));
+                                                    }
            | statements "\n" statement              { $1->statements.push_back(std::move($3)); $$ = std::move($1); }
            ;
 
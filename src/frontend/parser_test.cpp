@@ -4,7 +4,9 @@
 #include <gtest/gtest.h>
 #include <memory>
 #include <sstream>
+#include <string>
 #include <variant>
+#include <vector>
 
 #include "driver.hpp"
 #include "node.hpp"
@@ -595,3 +597,19 @@ TEST(parser, chained_getattr) {
     const auto & func1 = *std::get<std::unique_ptr<Frontend::AST::FunctionCall>>(func2.held);
     ASSERT_TRUE(std::holds_alternative<std::unique_ptr<Frontend::AST::Identifier>>(func1.held));
 }
+
+TEST(parser, first_statement) {
+    Frontend::Driver drv{};
+    drv.name = "test file name";
+
+    std::vector<std::string> seen{};
+    drv.first_statement = [&](const Frontend::AST::StatementV & stmt) {
+        seen.emplace_back(std::get<0>(stmt)->as_string());
+    };
+
+    // The callback happens before the rest of the file is parsed, so even a
+    // syntax error later on doesn't stop it
+    std::istringstream stream{"project('foo', 'cpp')\nif true\nx = 1\nendif\nx = = 1\n"};
+    ASSERT_ANY_THROW(drv.parse(stream));
+    ASSERT_EQ(seen, std::vector<std::string>{"project('foo', 'cpp')"});
+}
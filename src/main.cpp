@@ -16,6 +16,7 @@
 #include "lower.hpp"
 #include "options.hpp"
 #include "state/state.hpp"
+#include "thread_pool.hpp"
 #include "version.hpp"
 
 namespace fs = std::filesystem;
@@ -60,11 +61,20 @@ static int configure(const Options::ConfigureOptions & opts) {
               << "Source dir: " << Util::Log::bold(fs::absolute(opts.sourcedir)) << std::endl
               << "Build dir: " << Util::Log::bold(fs::absolute(opts.builddir)) << std::endl;
 
-    // Parse the source into a an AST
-    Frontend::Driver drv{};
-    auto block = drv.parse(opts.sourcedir / "meson.build");
+    // This must happen before anything uses the pool
+    Util::set_jobs(opts.jobs);
 
     MIR::State::Persistant pstate{opts.sourcedir, opts.builddir};
+    pstate.options = opts.options;
+    pstate.load_cache();
+
+    // Parse the source into a an AST, starting toolchain detection as soon as
+    // the project() call is seen, so that it happens while the rest is parsed
+    Frontend::Driver drv{};
+    drv.first_statement = [&](const Frontend::AST::StatementV & stmt) {
+        MIR::start_project(stmt, pstate);
+    };
+    auto block = drv.parse(opts.sourcedir / "meson.build");
 
     // Create IR from the AST, then run our lowering passes on it
     auto irlist = MIR::lower_ast(block, pstate);
@@ -77,6 +87,7 @@ static int configure(const Options::ConfigureOptions & opts) {
     }
 
     Backends::Ninja::generate(&irlist, pstate);
+    pstate.save_cache();
 
     return 0;
 };
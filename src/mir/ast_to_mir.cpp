@@ -2,6 +2,7 @@
 // Copyright © 2021 Intel Corporation
 
 #include <filesystem>
+#include <iterator>
 
 #include "ast_to_mir.hpp"
 #include "exceptions.hpp"
@@ -357,6 +358,27 @@ struct StatementLowering {
     };
 };
 
+/// Start detecting the languages in an argument, which may be nested arrays
+void detect_languages(const Frontend::AST::ExpressionV & expr, MIR::State::Persistant & pstate) {
+    if (const auto * arr = std::get_if<std::unique_ptr<Frontend::AST::Array>>(&expr)) {
+        for (const auto & e : (*arr)->elements) {
+            detect_languages(e, pstate);
+        }
+        return;
+    }
+
+    // Anything that isn't a plain string is left for lower_project
+    const auto * lang = std::get_if<std::unique_ptr<Frontend::AST::String>>(&expr);
+    if (lang == nullptr) {
+        return;
+    }
+    try {
+        pstate.detect_toolchain(Toolchain::from_string((*lang)->value));
+    } catch (Util::Exceptions::MesonException &) {
+        // An unknown language, which lower_project will report
+    }
+}
+
 } // namespace
 
 /**
@@ -374,4 +396,28 @@ BasicBlock lower_ast(const std::unique_ptr<Frontend::AST::CodeBlock> & block,
     return bl;
 }
 
+void start_project(const Frontend::AST::StatementV & stmt, MIR::State::Persistant & pstate) {
+    const auto * s = std::get_if<std::unique_ptr<Frontend::AST::Statement>>(&stmt);
+    if (s == nullptr) {
+        return;
+    }
+    const auto * f = std::get_if<std::unique_ptr<Frontend::AST::FunctionCall>>(&(*s)->expr);
+    if (f == nullptr) {
+        return;
+    }
+    const auto * id = std::get_if<std::unique_ptr<Frontend::AST::Identifier>>(&(*f)->held);
+    if (id == nullptr || (*id)->value != "project") {
+        return;
+    }
+
+    // The first argument is the project name, the rest are languages
+    const auto & args = (*f)->args->positional;
+    if (args.empty()) {
+        return;
+    }
+    for (auto it = std::next(args.begin()); it != args.end(); ++it) {
+        detect_languages(*it, pstate);
+    }
+}
+
 } // namespace MIR
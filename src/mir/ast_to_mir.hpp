@@ -13,4 +13,14 @@ namespace MIR {
 BasicBlock lower_ast(const std::unique_ptr<Frontend::AST::CodeBlock> &,
                      const MIR::State::Persistant &);
 
+/**
+ * Start detecting the toolchains for the languages of a `project()` call
+ *
+ * This is meant to be called with the first statement of the root
+ * meson.build as soon as it's parsed, so that detection runs while the rest of
+ * the tree is parsed and lowered. Anything that isn't a simple `project()`
+ * call is ignored, `lower_project` reports the errors.
+ */
+void start_project(const Frontend::AST::StatementV &, MIR::State::Persistant &);
+
 }; // namespace MIR
@@ -647,3 +647,33 @@ TEST(ast_to_ir, neg_simple) {
     ASSERT_EQ(ir->name, "unary_neg");
     ASSERT_EQ(std::get<std::shared_ptr<MIR::Number>>(ir->pos_args[0])->value, 5);
 }
+
+TEST(start_project, languages) {
+    MIR::State::Persistant pstate{"foo/src", "foo/build"};
+    const auto & block = parse("project('foo', 'cpp')");
+    MIR::start_project(block->statements.front(), pstate);
+    ASSERT_EQ(pstate.detecting.size(), 1);
+    ASSERT_EQ(pstate.detecting.count(MIR::Toolchain::Language::CPP), 1);
+}
+
+TEST(start_project, array) {
+    MIR::State::Persistant pstate{"foo/src", "foo/build"};
+    const auto & block = parse("project('foo', ['cpp', x, ['cobol', 'cpp']])");
+    MIR::start_project(block->statements.front(), pstate);
+    ASSERT_EQ(pstate.detecting.size(), 1);
+    ASSERT_EQ(pstate.detecting.count(MIR::Toolchain::Language::CPP), 1);
+}
+
+TEST(start_project, not_project) {
+    MIR::State::Persistant pstate{"foo/src", "foo/build"};
+    const auto & block = parse("message('cpp', 'cpp')");
+    MIR::start_project(block->statements.front(), pstate);
+    ASSERT_TRUE(pstate.detecting.empty());
+}
+
+TEST(start_project, unknown_language) {
+    MIR::State::Persistant pstate{"foo/src", "foo/build"};
+    const auto & block = parse("project('foo', 'cobol')");
+    MIR::start_project(block->statements.front(), pstate);
+    ASSERT_TRUE(pstate.detecting.empty());
+}
@@ -10,31 +10,74 @@ namespace MIR {
 
 namespace {
 
-void lower_impl(BasicBlock & block, State::Persistant & pstate) {
+void lower_impl(BasicBlock & block, State::Persistant & pstate, Passes::ProgramFinder & finder,
+                Passes::CompilerChecker & checker, Passes::DependencyFinder & dep_finder) {
     std::unordered_map<std::string, uint32_t> value_number_data{};
     Passes::ReplacementTable rt{};
     Passes::LastSeenTable lst{};
     Passes::PropTable pt{};
 
+    const auto lookups = [&](Passes::LookupMode mode) {
+        return Passes::block_walker(
+            &block,
+            {
+                [&](BasicBlock * b) { return Passes::find_programs(b, pstate, finder, mode); },
+                [&](BasicBlock * b) { return Passes::compiler_checks(b, checker, mode); },
+                [&](BasicBlock * b) {
+                    return Passes::find_dependencies(b, pstate, dep_finder, mode);
+                },
+            });
+    };
+
     bool progress = true;
     while (progress) {
+        // Number values first, so that cse can point duplicates at the
+        // definition they duplicate, before they're lowered in parallel
         progress = Passes::block_walker(
+            &block,
+            {[&](BasicBlock * b) { return Passes::value_numbering(b, value_number_data); }});
+        progress |= Passes::common_subexpression_elimination(&block);
+
+        // Passes which only look at a single block, and only read the
+        // persistant state, these are run on many blocks at once
+        progress |= Passes::parallel_block_walker(
             &block,
             {
                 [&](BasicBlock * b) { return Passes::flatten(b, pstate); },
                 [&](BasicBlock * b) { return Passes::lower_free_functions(b, pstate); },
+                [&](BasicBlock * b) { return Passes::lower_program_objects(*b, pstate); },
+                [&](BasicBlock * b) { return Passes::lower_string_objects(*b, pstate); },
+                [&](BasicBlock * b) { return Passes::lower_dependency_objects(*b, pstate); },
+            });
+
+        // Passes that change the shape of the CFG or that share state between
+        // blocks, these act as a barrier between the parallel walks
+        progress |= Passes::block_walker(
+            &block,
+            {
                 [](BasicBlock * b) { return Passes::delete_unreachable(*b); },
-                [&](BasicBlock * b) { return Passes::value_numbering(b, value_number_data); },
                 Passes::branch_pruning,
                 Passes::join_blocks,
                 Passes::fixup_phis,
                 [&](BasicBlock * b) { return Passes::usage_numbering(b, lst); },
                 [&](BasicBlock * b) { return Passes::constant_folding(b, rt); },
                 [&](BasicBlock * b) { return Passes::constant_propogation(b, pt); },
-                [&](BasicBlock * b) { return Passes::lower_program_objects(*b, pstate); },
-                [&](BasicBlock * b) { return Passes::lower_string_objects(*b, pstate); },
-                [&](BasicBlock * b) { return Passes::lower_dependency_objects(*b, pstate); },
             });
+        progress |= lookups(Passes::LookupMode::POLL);
+        progress |= Passes::sccp(&block);
+
+        // If nothing else can be lowered then we're waiting on lookups that
+        // haven't finished yet. Only the ones that succeeded are used, the
+        // others may be in branches that are pruned once they are.
+        if (!progress) {
+            progress = lookups(Passes::LookupMode::WAIT);
+        }
+
+        // A whole round, including pruning, has made no progress, so any
+        // failed lookups left are in live code
+        if (!progress) {
+            lookups(Passes::LookupMode::FINAL);
+        }
     }
 }
 
@@ -50,13 +93,16 @@ void lower(BasicBlock * block, State::Persistant & pstate) {
                                     Passes::insert_compilers(block, pstate.toolchains);
                          }});
 
-    // Run the main lowering loop until it cannot lower any more, then do the
-    // threaded lowering, which we run across the entire program to lower things
-    // like find_program(), Then run the main loop again until we've lowered it
-    // all away
-    lower_impl(*block, pstate);
-    Passes::threaded_lowering(block, pstate);
-    lower_impl(*block, pstate);
+    // Run the main lowering loop until it cannot lower any more. Lookups like
+    // find_program() and dependency() run in the background while lowering continues.
+    Passes::ProgramFinder finder{pstate.program_cache};
+    Passes::CompilerChecker checker{pstate.build_root / "meson-private" / "checks"};
+    Passes::DependencyFinder dep_finder{};
+    lower_impl(*block, pstate, finder, checker, dep_finder);
+
+    // Now that everything has been propagated into it's users, drop any values
+    // that are no longer read, there's no reason to hand them to the backend
+    Passes::delete_dead_values(block);
 }
 
 } // namespace MIR
@@ -68,6 +68,50 @@ Info detect_build() {
     return Info{Machine::BUILD, detect_kernel(), detect_endian(), detect_cpu_family()};
 }
 
+std::optional<Info> from_macros(const Machine & machine,
+                                const std::unordered_map<std::string, std::string> & macros) {
+    const auto defined = [&](const std::string & name) { return macros.count(name) != 0; };
+
+    if (!defined("__linux__")) {
+        return std::nullopt;
+    }
+
+    std::string cpu_family;
+    if (defined("__x86_64__")) {
+        cpu_family = "x86_64";
+    } else if (defined("__i386__")) {
+        cpu_family = "x86";
+    } else if (defined("__aarch64__")) {
+        cpu_family = "aarch64";
+    } else if (defined("__arm__")) {
+        cpu_family = "arm";
+    } else if (defined("__powerpc64__")) {
+        cpu_family = "ppc64";
+    } else if (defined("__powerpc__")) {
+        cpu_family = "ppc";
+    } else if (defined("__riscv")) {
+        const auto & xlen = macros.find("__riscv_xlen");
+        cpu_family = xlen != macros.end() && xlen->second == "64" ? "riscv64" : "riscv32";
+    } else {
+        return std::nullopt;
+    }
+
+    const auto & order = macros.find("__BYTE_ORDER__");
+    if (order == macros.end()) {
+        return std::nullopt;
+    }
+    Endian endian;
+    if (order->second == "__ORDER_LITTLE_ENDIAN__") {
+        endian = Endian::LITTLE;
+    } else if (order->second == "__ORDER_BIG_ENDIAN__") {
+        endian = Endian::BIG;
+    } else {
+        return std::nullopt;
+    }
+
+    return Info{machine, Kernel::LINUX, endian, cpu_family};
+}
+
 const std::string Info::system() const {
     switch (kernel) {
         case Kernel::LINUX:
@@ -6,6 +6,7 @@
 #include <cassert>
 #include <optional>
 #include <string>
+#include <unordered_map>
 
 namespace MIR::Machines {
 
@@ -49,11 +50,11 @@ class Info {
 
     const std::string system() const;
 
-    const Machine machine;
-    const Kernel kernel;
-    const Endian endian;
-    const std::string cpu_family;
-    const std::string cpu;
+    Machine machine;
+    Kernel kernel;
+    Endian endian;
+    std::string cpu_family;
+    std::string cpu;
 };
 
 template <typename T> class PerMachine {
@@ -149,4 +150,12 @@ template <typename T> class PerMachine {
  */
 Info detect_build();
 
+/**
+ * Get the information for a machine from the macros a compiler predefines
+ *
+ * Returns nullopt if the kernel or cpu family isn't recognized.
+ */
+std::optional<Info> from_macros(const Machine &,
+                                const std::unordered_map<std::string, std::string> & macros);
+
 } // namespace MIR::Machines
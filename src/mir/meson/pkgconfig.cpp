@@ -0,0 +1,469 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <set>
+#include <sstream>
+
+#include "exceptions.hpp"
+#include "path_index.hpp"
+#include "pkgconfig.hpp"
+
+namespace MIR::PkgConfig {
+
+namespace {
+
+using Requirements = std::vector<std::tuple<std::string, std::vector<Constraint>>>;
+
+std::string strip(const std::string & s) {
+    const auto start = s.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) {
+        return "";
+    }
+    const auto end = s.find_last_not_of(" \t\r\n");
+    return s.substr(start, end - start + 1);
+}
+
+bool is_operator(char c) { return c == '<' || c == '>' || c == '=' || c == '!'; }
+
+/// Expand `${var}` references, `$$` is a literal `$`
+std::string expand(const std::string & value,
+                   const std::unordered_map<std::string, std::string> & vars,
+                   const fs::path & path) {
+    std::string out{};
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        if (value[i] != '$' || i + 1 == value.size()) {
+            out += value[i];
+        } else if (value[i + 1] == '$') {
+            out += '$';
+            ++i;
+        } else if (value[i + 1] == '{') {
+            const auto end = value.find('}', i);
+            if (end == std::string::npos) {
+                throw Util::Exceptions::MesonException(path.string() +
+                                                       ": unterminated variable reference");
+            }
+            const std::string name = value.substr(i + 2, end - i - 2);
+            const auto & v = vars.find(name);
+            if (v == vars.end()) {
+                throw Util::Exceptions::MesonException(path.string() + ": undefined variable \"" +
+                                                       name + "\"");
+            }
+            out += v->second;
+            i = end;
+        } else {
+            out += value[i];
+        }
+    }
+    return out;
+}
+
+/// Split flags the way a shell would, honoring quotes and backslashes
+std::vector<std::string> split_flags(const std::string & value) {
+    std::vector<std::string> flags{};
+    std::string current{};
+    bool in_arg = false;
+    char quote = '\0';
+
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        const char c = value[i];
+        if (quote == '\'') {
+            if (c == '\'') {
+                quote = '\0';
+            } else {
+                current += c;
+            }
+        } else if (quote == '"') {
+            if (c == '"') {
+                quote = '\0';
+            } else if (c == '\\' && i + 1 < value.size()) {
+                current += value[++i];
+            } else {
+                current += c;
+            }
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+            in_arg = true;
+        } else if (c == '\\' && i + 1 < value.size()) {
+            current += value[++i];
+            in_arg = true;
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            if (in_arg) {
+                flags.emplace_back(std::move(current));
+                current = {};
+                in_arg = false;
+            }
+        } else {
+            current += c;
+            in_arg = true;
+        }
+    }
+    if (in_arg) {
+        flags.emplace_back(std::move(current));
+    }
+    return flags;
+}
+
+/**
+ * Join flags that have their value as a separate argument, like `-I /foo`
+ *
+ * This gives `-I/foo`, which every compiler understands, and is how the rest
+ * of meson++ expects these flags. Flags that can only be given a separate
+ * value, like `-Xlinker`, are left alone.
+ */
+std::vector<std::string> join_flag_values(std::vector<std::string> && flags) {
+    static const std::set<std::string> joinable{
+        "-I", "-L", "-l", "-D", "-U", "-isystem", "-idirafter", "-iquote",
+    };
+    std::vector<std::string> out{};
+    for (std::size_t i = 0; i < flags.size(); ++i) {
+        if (joinable.count(flags[i]) != 0 && i + 1 < flags.size()) {
+            out.emplace_back(flags[i] + flags[i + 1]);
+            ++i;
+        } else {
+            out.emplace_back(std::move(flags[i]));
+        }
+    }
+    return out;
+}
+
+/// Parse a Requires field, such as `foo >= 1.0, bar`
+Requirements split_requires(const std::string & value) {
+    // Operators may or may not be separated from the names and versions by
+    // whitespace, so make sure they are before splitting
+    std::string spaced{};
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        const char c = value[i];
+        if (c == ',') {
+            spaced += ' ';
+        } else if (is_operator(c)) {
+            spaced += ' ';
+            while (i < value.size() && is_operator(value[i])) {
+                spaced += value[i++];
+            }
+            spaced += ' ';
+            --i;
+        } else {
+            spaced += c;
+        }
+    }
+
+    std::vector<std::string> tokens{};
+    std::istringstream in{spaced};
+    for (std::string t; in >> t;) {
+        tokens.emplace_back(t);
+    }
+
+    Requirements reqs{};
+    for (std::size_t i = 0; i < tokens.size(); ++i) {
+        if (is_operator(tokens[i][0])) {
+            if (reqs.empty() || i + 1 == tokens.size()) {
+                throw Util::Exceptions::MesonException("Invalid requirement list: " + value);
+            }
+            std::get<1>(reqs.back()).emplace_back(parse_constraint(tokens[i] + tokens[i + 1]));
+            ++i;
+        } else {
+            reqs.emplace_back(tokens[i], std::vector<Constraint>{});
+        }
+    }
+    return reqs;
+}
+
+/// Is this an argument pointing at a directory that is always searched?
+bool is_system_dir_arg(const std::string & arg) {
+    static const std::set<std::string> system{
+        "-I/usr/include", "-L/usr/lib", "-L/usr/lib64", "-L/lib", "-L/lib64",
+    };
+    if (system.count(arg) != 0) {
+        return true;
+    }
+    // Debian style multiarch directories, such as /usr/lib/x86_64-linux-gnu
+    for (const std::string prefix : {"-L/usr/lib/", "-L/lib/"}) {
+        if (arg.compare(0, prefix.size(), prefix) == 0 &&
+            arg.find('/', prefix.size()) == std::string::npos &&
+            arg.find("-linux-", prefix.size()) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Can a duplicate of this argument be removed?
+ *
+ * Only search paths, libraries, and defines are, which stand on their own
+ * once `join_flag_values()` has been applied. Anything else may be one half
+ * of a flag and it's value, like `-Xlinker foo`, or mean something different
+ * when repeated.
+ */
+bool is_dedupable(const std::string & arg) {
+    if (arg.size() <= 2 || arg[0] != '-') {
+        return false;
+    }
+    return arg[1] == 'I' || arg[1] == 'L' || arg[1] == 'l' || arg[1] == 'D';
+}
+
+/// Remove duplicates, keeping the first instance of each argument
+std::vector<std::string> dedup_first(const std::vector<std::string> & args) {
+    std::vector<std::string> out{};
+    std::set<std::string> seen{};
+    for (const auto & a : args) {
+        if (!is_dedupable(a) || seen.insert(a).second) {
+            out.emplace_back(a);
+        }
+    }
+    return out;
+}
+
+/**
+ * Remove duplicates, keeping the last instance of each argument
+ *
+ * Libraries must come after everything that uses them, so the last instance is
+ * the one that matters.
+ */
+std::vector<std::string> dedup_last(const std::vector<std::string> & args) {
+    std::vector<std::string> out{};
+    std::set<std::string> seen{};
+    for (auto it = args.rbegin(); it != args.rend(); ++it) {
+        if (!is_dedupable(*it) || seen.insert(*it).second) {
+            out.emplace_back(*it);
+        }
+    }
+    std::reverse(out.begin(), out.end());
+    return out;
+}
+
+bool satisfies(const std::string & version, const std::vector<Constraint> & constraints) {
+    return std::all_of(constraints.begin(), constraints.end(), [&](const Constraint & c) {
+        return Version::compare(version, c.op, c.version);
+    });
+}
+
+} // namespace
+
+Constraint parse_constraint(const std::string & raw) {
+    std::string str{};
+    for (const auto & c : raw) {
+        if (!std::isspace(static_cast<unsigned char>(c))) {
+            str += c;
+        }
+    }
+
+    static const std::vector<std::tuple<std::string, Version::Operator>> ops{
+        {"==", Version::Operator::EQ}, {"!=", Version::Operator::NE},
+        {">=", Version::Operator::GE}, {"<=", Version::Operator::LE},
+        {"=", Version::Operator::EQ},  {"<", Version::Operator::LT},
+        {">", Version::Operator::GT},
+    };
+    for (const auto & [s, op] : ops) {
+        if (str.compare(0, s.size(), s) == 0) {
+            return Constraint{op, str.substr(s.size())};
+        }
+    }
+    return Constraint{Version::Operator::EQ, str};
+}
+
+File parse(const fs::path & path) {
+    std::ifstream in{path};
+    if (!in.is_open()) {
+        throw Util::Exceptions::MesonException("Could not read " + path.string());
+    }
+
+    std::unordered_map<std::string, std::string> vars{
+        {"pcfiledir", path.parent_path().string()},
+    };
+    File file{};
+
+    std::string line;
+    while (std::getline(in, line)) {
+        // A trailing backslash continues the line
+        while (!line.empty() && line.back() == '\\') {
+            line.pop_back();
+            std::string next;
+            if (!std::getline(in, next)) {
+                break;
+            }
+            line += next;
+        }
+        if (const auto hash = line.find('#'); hash != std::string::npos) {
+            line.erase(hash);
+        }
+        line = strip(line);
+        if (line.empty()) {
+            continue;
+        }
+
+        const auto sep = line.find_first_of(":=");
+        if (sep == std::string::npos) {
+            continue;
+        }
+        const std::string key = strip(line.substr(0, sep));
+        const std::string value = expand(strip(line.substr(sep + 1)), vars, path);
+
+        if (line[sep] == '=') {
+            vars[key] = value;
+        } else if (key == "Name") {
+            file.name = value;
+        } else if (key == "Version") {
+            file.version = value;
+        } else if (key == "Requires") {
+            file.required = split_requires(value);
+        } else if (key == "Requires.private") {
+            file.required_private = split_requires(value);
+        } else if (key == "Cflags" || key == "CFlags") {
+            file.cflags = join_flag_values(split_flags(value));
+        } else if (key == "Cflags.private" || key == "CFlags.private") {
+            file.cflags_private = join_flag_values(split_flags(value));
+        } else if (key == "Libs") {
+            file.libs = join_flag_values(split_flags(value));
+        } else if (key == "Libs.private") {
+            file.libs_private = join_flag_values(split_flags(value));
+        }
+    }
+
+    return file;
+}
+
+Resolver::Resolver(const std::vector<fs::path> & p) : search_path{p} {}
+
+std::shared_ptr<const File> Resolver::load(const std::string & name) const {
+    {
+        std::lock_guard l{lock};
+        if (const auto & f = files.find(name); f != files.end()) {
+            return f->second;
+        }
+    }
+
+    // Parse outside of the lock, if two threads race to load the same file
+    // the first one wins
+    std::shared_ptr<const File> file = nullptr;
+    for (const auto & dir : search_path) {
+        const fs::path path = dir / (name + ".pc");
+        std::error_code ec{};
+        if (fs::is_regular_file(path, ec)) {
+            file = std::make_shared<const File>(parse(path));
+            break;
+        }
+    }
+
+    std::lock_guard l{lock};
+    return files.emplace(name, std::move(file)).first->second;
+}
+
+std::optional<Package> Resolver::find(const std::string & name,
+                                      const std::vector<Constraint> & constraints,
+                                      bool static_) const {
+    // Every package reachable from this one, and whether it's libraries are
+    // needed
+    std::vector<std::tuple<std::string, std::shared_ptr<const File>>> order{};
+    std::unordered_map<std::string, bool> needs_libs{};
+
+    std::function<bool(const std::string &, const std::vector<Constraint> &, bool)> visit =
+        [&](const std::string & n, const std::vector<Constraint> & cons, bool libs) {
+            const auto & file = load(n);
+            if (file == nullptr || !satisfies(file->version, cons)) {
+                return false;
+            }
+
+            // Already visited, but it's libraries may now be needed
+            const auto & it = needs_libs.find(n);
+            const bool first = it == needs_libs.end();
+            if (first) {
+                needs_libs.emplace(n, libs);
+            } else if (!libs || it->second) {
+                return true;
+            } else {
+                it->second = true;
+            }
+
+            for (const auto & [r, rcons] : file->required) {
+                if (!visit(r, rcons, libs)) {
+                    return false;
+                }
+            }
+            // Private requirements are needed for their headers, but their
+            // libraries are only needed when linking statically
+            for (const auto & [r, rcons] : file->required_private) {
+                if (!visit(r, rcons, libs && static_)) {
+                    return false;
+                }
+            }
+
+            // Post order, so that a package comes after everything it requires
+            if (first) {
+                order.emplace_back(n, file);
+            }
+            return true;
+        };
+
+    if (!visit(name, constraints, true)) {
+        return std::nullopt;
+    }
+    // Each package must come before the packages it requires, so that it's
+    // libraries are linked before the libraries they use
+    std::reverse(order.begin(), order.end());
+
+    std::vector<std::string> cflags{};
+    std::vector<std::string> libs{};
+    for (const auto & [n, file] : order) {
+        std::copy_if(file->cflags.begin(), file->cflags.end(), std::back_inserter(cflags),
+                     [](const std::string & a) { return !is_system_dir_arg(a); });
+        if (static_) {
+            std::copy_if(file->cflags_private.begin(), file->cflags_private.end(),
+                         std::back_inserter(cflags),
+                         [](const std::string & a) { return !is_system_dir_arg(a); });
+        }
+        if (needs_libs.at(n)) {
+            std::copy_if(file->libs.begin(), file->libs.end(), std::back_inserter(libs),
+                         [](const std::string & a) { return !is_system_dir_arg(a); });
+            if (static_) {
+                std::copy_if(file->libs_private.begin(), file->libs_private.end(),
+                             std::back_inserter(libs),
+                             [](const std::string & a) { return !is_system_dir_arg(a); });
+            }
+        }
+    }
+
+    return Package{name, std::get<1>(order.front())->version, dedup_first(cflags),
+                   dedup_last(libs)};
+}
+
+std::vector<fs::path> default_search_path() {
+    std::vector<fs::path> dirs{};
+    if (const char * env = std::getenv("PKG_CONFIG_PATH"); env != nullptr && *env != '\0') {
+        for (const auto & d : Util::split_path(env)) {
+            dirs.emplace_back(d);
+        }
+    }
+
+    if (const char * env = std::getenv("PKG_CONFIG_LIBDIR"); env != nullptr) {
+        for (const auto & d : Util::split_path(env)) {
+            dirs.emplace_back(d);
+        }
+        return dirs;
+    }
+
+    dirs.emplace_back("/usr/local/lib/pkgconfig");
+    dirs.emplace_back("/usr/local/share/pkgconfig");
+    // Debian style multiarch directories
+    std::vector<fs::path> multiarch{};
+    std::error_code ec{};
+    for (const auto & e : fs::directory_iterator{"/usr/lib", ec}) {
+        if (e.path().filename().string().find("-linux-") != std::string::npos) {
+            multiarch.emplace_back(e.path() / "pkgconfig");
+        }
+    }
+    std::sort(multiarch.begin(), multiarch.end());
+    dirs.insert(dirs.end(), multiarch.begin(), multiarch.end());
+    dirs.emplace_back("/usr/lib64/pkgconfig");
+    dirs.emplace_back("/usr/lib/pkgconfig");
+    dirs.emplace_back("/usr/share/pkgconfig");
+    return dirs;
+}
+
+} // namespace MIR::PkgConfig
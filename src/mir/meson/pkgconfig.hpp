@@ -0,0 +1,113 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+/**
+ * An in process implementation of pkg-config
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "version.hpp"
+
+namespace MIR::PkgConfig {
+
+namespace fs = std::filesystem;
+
+/// A version requirement, such as `>= 1.0`
+struct Constraint {
+    Version::Operator op;
+    std::string version;
+};
+
+/**
+ * Parse a version constraint
+ *
+ * Accepts both the pkg-config (`=`) and meson (`==`) spelling of equality, a
+ * version without an operator is treated as equality.
+ */
+Constraint parse_constraint(const std::string &);
+
+/// A single .pc file, with variables expanded
+struct File {
+    std::string name;
+    std::string version;
+
+    /// Requires and Requires.private, as (name, constraints)
+    std::vector<std::tuple<std::string, std::vector<Constraint>>> required;
+    std::vector<std::tuple<std::string, std::vector<Constraint>>> required_private;
+
+    std::vector<std::string> cflags;
+    std::vector<std::string> cflags_private;
+    std::vector<std::string> libs;
+    std::vector<std::string> libs_private;
+};
+
+/**
+ * Parse a .pc file
+ *
+ * @param path the file to read
+ * @throws Util::Exceptions::MesonException if the file is invalid
+ */
+File parse(const fs::path & path);
+
+/// A package with all of it's requirements resolved
+struct Package {
+    std::string name;
+    std::string version;
+    std::vector<std::string> cflags;
+    std::vector<std::string> libs;
+};
+
+/**
+ * Find packages and resolve their requirements
+ *
+ * Parsed files are shared between lookups, so that a package required by
+ * many others is only read once. This is safe to use from multiple threads.
+ */
+class Resolver {
+  public:
+    explicit Resolver(const std::vector<fs::path> & search_path);
+
+    /**
+     * Find a package and everything it requires
+     *
+     * @param name The package to find
+     * @param constraints The versions of the package that are acceptable
+     * @param static_ Whether to include the private libraries and cflags
+     * @return The package, or std::nullopt if it or one of it's requirements
+     *         was not found or has the wrong version
+     */
+    std::optional<Package> find(const std::string & name,
+                                const std::vector<Constraint> & constraints,
+                                bool static_ = false) const;
+
+  private:
+    std::shared_ptr<const File> load(const std::string & name) const;
+
+    const std::vector<fs::path> search_path;
+
+    mutable std::mutex lock;
+
+    /// Loaded files by package name, nullptr if it wasn't found
+    mutable std::unordered_map<std::string, std::shared_ptr<const File>> files;
+};
+
+/**
+ * Get the directories to search for .pc files
+ *
+ * This uses `PKG_CONFIG_PATH` followed by `PKG_CONFIG_LIBDIR`, or if that
+ * isn't set, the usual system directories.
+ */
+std::vector<fs::path> default_search_path();
+
+} // namespace MIR::PkgConfig
@@ -0,0 +1,150 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "pkgconfig.hpp"
+#include "test_directory.hpp"
+
+namespace fs = std::filesystem;
+namespace PC = MIR::PkgConfig;
+
+namespace {
+
+class PkgConfigTest : public ::testing::Test {
+  protected:
+    void write(const std::string & name, const std::string & contents) {
+        std::ofstream out{dir / (name + ".pc")};
+        out << contents;
+    }
+
+    const Util::TestDirectory tmp{};
+    const fs::path & dir = tmp.path;
+};
+
+} // namespace
+
+TEST(parse_constraint, operators) {
+    const auto & c1 = PC::parse_constraint(">= 1.2");
+    ASSERT_EQ(c1.op, MIR::Version::Operator::GE);
+    ASSERT_EQ(c1.version, "1.2");
+
+    const auto & c2 = PC::parse_constraint("=1.0");
+    ASSERT_EQ(c2.op, MIR::Version::Operator::EQ);
+    ASSERT_EQ(c2.version, "1.0");
+
+    const auto & c3 = PC::parse_constraint("2.0");
+    ASSERT_EQ(c3.op, MIR::Version::Operator::EQ);
+    ASSERT_EQ(c3.version, "2.0");
+
+    const auto & c4 = PC::parse_constraint("<3");
+    ASSERT_EQ(c4.op, MIR::Version::Operator::LT);
+    ASSERT_EQ(c4.version, "3");
+}
+
+TEST_F(PkgConfigTest, variables) {
+    write("foo", R"EOF(
+# a comment
+prefix=/opt/foo
+libdir=${prefix}/lib
+includedir=${prefix}/include
+
+Name: foo
+Description: A test package
+Version: 1.2.3
+Cflags: -I${includedir} -DFOO="a b" -DDOLLAR=$$x
+Libs: -L${libdir} \
+    -lfoo
+)EOF");
+
+    const auto & file = PC::parse(dir / "foo.pc");
+    ASSERT_EQ(file.name, "foo");
+    ASSERT_EQ(file.version, "1.2.3");
+    ASSERT_EQ(file.cflags,
+              (std::vector<std::string>{"-I/opt/foo/include", "-DFOO=a b", "-DDOLLAR=$x"}));
+    ASSERT_EQ(file.libs, (std::vector<std::string>{"-L/opt/foo/lib", "-lfoo"}));
+}
+
+TEST_F(PkgConfigTest, requires) {
+    write("foo", "Name: foo\nVersion: 1.0\nRequires: bar >= 2.0, baz\nRequires.private: "
+                 "priv\nCflags: -DFOO\nLibs: -lfoo\nLibs.private: -lfoopriv\n");
+    write("bar", "Name: bar\nVersion: 2.1\nRequires: baz\nCflags: -DBAR\nLibs: -lbar\n");
+    write("baz", "Name: baz\nVersion: 1\nCflags: -DBAZ\nLibs: -lbaz\n");
+    write("priv", "Name: priv\nVersion: 1\nCflags: -DPRIV\nLibs: -lpriv\n");
+
+    const PC::Resolver resolver{{dir}};
+
+    const auto & shared = resolver.find("foo", {});
+    ASSERT_TRUE(shared.has_value());
+    ASSERT_EQ(shared->version, "1.0");
+    ASSERT_EQ(shared->cflags, (std::vector<std::string>{"-DFOO", "-DPRIV", "-DBAR", "-DBAZ"}));
+    // baz must come after bar, which uses it
+    ASSERT_EQ(shared->libs, (std::vector<std::string>{"-lfoo", "-lbar", "-lbaz"}));
+
+    const auto & static_ = resolver.find("foo", {}, true);
+    ASSERT_TRUE(static_.has_value());
+    ASSERT_EQ(static_->libs,
+              (std::vector<std::string>{"-lfoo", "-lfoopriv", "-lpriv", "-lbar", "-lbaz"}));
+}
+
+TEST_F(PkgConfigTest, versions) {
+    write("foo", "Name: foo\nVersion: 1.0\nRequires: bar > 2.0\n");
+    write("bar", "Name: bar\nVersion: 2.0\n");
+
+    const PC::Resolver resolver{{dir}};
+    ASSERT_TRUE(resolver.find("bar", {PC::parse_constraint(">=2.0")}).has_value());
+    ASSERT_FALSE(resolver.find("bar", {PC::parse_constraint("<2.0")}).has_value());
+    // The requirement isn't met
+    ASSERT_FALSE(resolver.find("foo", {}).has_value());
+}
+
+TEST_F(PkgConfigTest, missing) {
+    write("foo", "Name: foo\nVersion: 1.0\nRequires: nope\n");
+
+    const PC::Resolver resolver{{dir}};
+    ASSERT_FALSE(resolver.find("foo", {}).has_value());
+    ASSERT_FALSE(resolver.find("nope", {}).has_value());
+}
+
+TEST_F(PkgConfigTest, cycle) {
+    write("foo", "Name: foo\nVersion: 1.0\nRequires: bar\nLibs: -lfoo\n");
+    write("bar", "Name: bar\nVersion: 1.0\nRequires: foo\nLibs: -lbar\n");
+
+    const PC::Resolver resolver{{dir}};
+    const auto & pkg = resolver.find("foo", {});
+    ASSERT_TRUE(pkg.has_value());
+    ASSERT_EQ(pkg->libs, (std::vector<std::string>{"-lfoo", "-lbar"}));
+}
+
+TEST_F(PkgConfigTest, system_dirs) {
+    write("foo", "Name: foo\nVersion: 1.0\nCflags: -I/usr/include -I/usr/include/foo\n"
+                 "Libs: -L/usr/lib -lfoo\n");
+
+    const PC::Resolver resolver{{dir}};
+    const auto & pkg = resolver.find("foo", {});
+    ASSERT_TRUE(pkg.has_value());
+    ASSERT_EQ(pkg->cflags, (std::vector<std::string>{"-I/usr/include/foo"}));
+    ASSERT_EQ(pkg->libs, (std::vector<std::string>{"-lfoo"}));
+}
+
+TEST_F(PkgConfigTest, separate_values) {
+    write("foo", "Name: foo\nVersion: 1.0\nRequires: bar\n"
+                 "Cflags: -isystem /a -isystem /b -I /c -include f.h -DFOO\n"
+                 "Libs: -Xlinker x -Xlinker y -L /d -lfoo\n");
+    write("bar", "Name: bar\nVersion: 1.0\nCflags: -I/c -include f.h -DFOO\n"
+                 "Libs: -Xlinker x -L/d -lfoo\n");
+
+    const PC::Resolver resolver{{dir}};
+    const auto & pkg = resolver.find("foo", {});
+    ASSERT_TRUE(pkg.has_value());
+    // Flags with separate values are kept whole, and only the arguments that
+    // stand on their own are deduplicated
+    ASSERT_EQ(pkg->cflags, (std::vector<std::string>{"-isystem/a", "-isystem/b", "-I/c",
+                                                     "-include", "f.h", "-DFOO", "-include",
+                                                     "f.h"}));
+    ASSERT_EQ(pkg->libs, (std::vector<std::string>{"-Xlinker", "x", "-Xlinker", "y", "-Xlinker",
+                                                   "x", "-L/d", "-lfoo"}));
+}
@@ -1,12 +1,52 @@
 // SPDX-license-identifier: Apache-2.0
 // Copyright © 2021-2022 Dylan Baker
 
+#include <cstdlib>
+
 #include "state.hpp"
+#include "thread_pool.hpp"
 
 namespace MIR::State {
 
+namespace {
+
+std::string get_path() {
+    const char * env = std::getenv("PATH");
+    return env != nullptr ? env : "";
+}
+
+} // namespace
+
 Persistant::Persistant(const std::filesystem::path & sr_, const std::filesystem::path & br_)
-    : toolchains{}, machines{Machines::detect_build()}, source_root{sr_},
-      build_root{br_}, programs{} {};
+    : toolchains{}, machines{Machines::detect_build()}, source_root{sr_}, build_root{br_},
+      programs{}, program_cache{std::make_shared<Util::ProgramCache>(get_path())},
+      toolchain_cache{std::make_shared<Toolchain::ToolchainCache>()} {};
+
+void Persistant::detect_toolchain(const Toolchain::Language & lang) {
+    if (toolchains.find(lang) != toolchains.end() || detecting.find(lang) != detecting.end()) {
+        return;
+    }
+    // The linker may be chosen with an option such as `-Dcpp_ld=mold`
+    std::string linker{};
+    if (auto opt = options.find(Toolchain::to_string(lang) + "_ld"); opt != options.end()) {
+        linker = opt->second;
+    }
 
+    // TODO: need to do host as well, when that is relavent
+    detecting.emplace(lang, Util::pool().submit([lang, linker, cache = toolchain_cache]() {
+        return std::make_shared<Toolchain::Toolchain>(
+            cache->get(lang, Machines::Machine::BUILD, linker));
+    }));
 }
+
+void Persistant::load_cache() {
+    program_cache->load(build_root / "meson-private" / "programs.cache");
+    toolchain_cache->load(build_root / "meson-private" / "toolchains.cache");
+}
+
+void Persistant::save_cache() const {
+    program_cache->save(build_root / "meson-private" / "programs.cache");
+    toolchain_cache->save(build_root / "meson-private" / "toolchains.cache");
+}
+
+} // namespace MIR::State
@@ -4,9 +4,13 @@
 #pragma once
 
 #include <filesystem>
+#include <future>
+#include <memory>
 #include <unordered_map>
 
 #include "machines.hpp"
+#include "program_cache.hpp"
+#include "toolchains/cache.hpp"
 #include "toolchains/toolchain.hpp"
 
 namespace fs = std::filesystem;
@@ -28,6 +32,15 @@ class Persistant {
                        Machines::PerMachine<std::shared_ptr<Toolchain::Toolchain>>>
         toolchains;
 
+    /**
+     * Toolchains that are still being detected, by language
+     *
+     * Detection may be started before lowering, as soon as the project() call
+     * has been parsed, and is finished by `lower_project`.
+     */
+    std::unordered_map<Toolchain::Language, std::future<std::shared_ptr<Toolchain::Toolchain>>>
+        detecting;
+
     /// The information on each machine
     /// XXX: currently only handle host == build configurations, as we don't have
     /// a machine file
@@ -42,13 +55,40 @@ class Persistant {
     /// The name of the project
     std::string name;
 
+    /// Options set on the command line with `-Dname=value`
+    std::unordered_map<std::string, std::string> options;
+
     /**
-     * Programs found by the `find_program` function. These are cached across re-runs
+     * Programs found by the `find_program` function.
      *
      * These are stored int [str: path] format, an actual representation has to
      * be built when getting a value from the cache.
      */
     Machines::PerMachine<std::unordered_map<std::string, fs::path>> programs;
+
+    /**
+     * Lookups of programs in PATH, these are cached across re-runs
+     *
+     * This is shared with lookups running in the thread pool, which may
+     * outlive lowering.
+     */
+    std::shared_ptr<Util::ProgramCache> program_cache;
+
+    /**
+     * Detected toolchains, these are cached across re-runs
+     *
+     * This is shared with detection running in the thread pool.
+     */
+    std::shared_ptr<Toolchain::ToolchainCache> toolchain_cache;
+
+    /// Start detecting the toolchain for a language, unless it already has been
+    void detect_toolchain(const Toolchain::Language &);
+
+    /// Load the caches from the build directory, dropping anything out of date
+    void load_cache();
+
+    /// Write the caches to the build directory
+    void save_cache() const;
 };
 
 } // namespace MIR::State
@@ -55,6 +55,9 @@ class Gnu : public Archiver {
     std::vector<std::string> always_args() const final;
 };
 
+/// The binaries tried, in order of preference, when none are given
+const std::vector<std::string> & default_binaries();
+
 /**
  * Find the static archiver to use
  */
@@ -0,0 +1,359 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <sys/stat.h>
+
+#include "cache.hpp"
+#include "compilers/cpp/cpp.hpp"
+#include "exceptions.hpp"
+#include "path_index.hpp"
+#include "thread_pool.hpp"
+
+namespace MIR::Toolchain {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const std::string CACHE_HEADER = "meson++ toolchain cache 3";
+
+/// Environment variables that change which tools are found, or how
+const std::vector<std::string> ENVIRONMENT{"PATH", "CXX", "CXX_LD", "AR"};
+
+std::string get_environment() {
+    std::string out{};
+    for (const auto & name : ENVIRONMENT) {
+        if (!out.empty()) {
+            out.push_back('\t');
+        }
+        out.append(name);
+        // Unset and set to empty are different
+        if (const char * value = std::getenv(name.c_str()); value != nullptr) {
+            out.push_back('=');
+            out.append(value);
+        }
+    }
+    return out;
+}
+
+std::string get_path() {
+    const char * env = std::getenv("PATH");
+    return env != nullptr ? env : "";
+}
+
+/// Tabs and newlines are used as separators in the cache file
+bool serializable(const std::string & s) {
+    return s.find_first_of("\t\n") == std::string::npos;
+}
+
+bool serializable(const std::vector<std::string> & v) {
+    for (const auto & s : v) {
+        if (!serializable(s)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> split(const std::string & line) {
+    std::vector<std::string> out{};
+    std::istringstream ss{line};
+    std::string field{};
+    while (std::getline(ss, field, '\t')) {
+        out.emplace_back(field);
+    }
+    return out;
+}
+
+void write_fields(std::ostream & out, const std::vector<std::string> & fields) {
+    for (const auto & f : fields) {
+        out << '\t' << f;
+    }
+}
+
+} // namespace
+
+bool ToolchainCache::Probe::operator==(const Probe & o) const {
+    return name == o.name && path == o.path && dev == o.dev && ino == o.ino &&
+           mtime == o.mtime && size == o.size;
+}
+
+ToolchainCache::ToolchainCache()
+    : environment{get_environment()}, dirs{Util::split_path(get_path())} {}
+
+ToolchainCache::Probe ToolchainCache::probe(const std::string & name) const {
+    Probe p{name, {}};
+
+    fs::path found{};
+    if (name.find('/') != std::string::npos) {
+        if (Util::is_executable(name)) {
+            found = name;
+        }
+    } else {
+        for (const auto & d : dirs) {
+            if (Util::is_executable(d / name)) {
+                found = d / name;
+                break;
+            }
+        }
+    }
+    if (found.empty()) {
+        return p;
+    }
+
+    // Compilers are usually symlinks (c++ -> g++ -> g++-12), so look at the
+    // real file, and remember where it is so that switching is noticed
+    std::error_code ec{};
+    p.path = fs::canonical(found, ec);
+    struct stat st;
+    if (ec || stat(p.path.c_str(), &st) != 0) {
+        p.path.clear();
+        return p;
+    }
+    p.dev = static_cast<std::uint64_t>(st.st_dev);
+    p.ino = static_cast<std::uint64_t>(st.st_ino);
+    p.mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    p.size = static_cast<std::int64_t>(st.st_size);
+    return p;
+}
+
+std::vector<ToolchainCache::Probe> ToolchainCache::probe_all(const Language & lang) const {
+    std::vector<Probe> probes{};
+    for (const auto & name : Compiler::default_binaries(lang)) {
+        probes.emplace_back(probe(name));
+    }
+    for (const auto & name : Archiver::default_binaries()) {
+        probes.emplace_back(probe(name));
+    }
+    // The compiler runs `ld` unless another linker is selected, and that's
+    // often switched between linkers with a symlink
+    probes.emplace_back(probe("ld"));
+    return probes;
+}
+
+std::optional<Toolchain> ToolchainCache::create(const Entry & entry) {
+    std::unique_ptr<Compiler::Compiler> comp;
+    if (entry.compiler == "gcc") {
+        comp = std::make_unique<Compiler::CPP::Gnu>(entry.compiler_command, entry.version,
+                                                    entry.macros);
+    } else if (entry.compiler == "clang") {
+        comp = std::make_unique<Compiler::CPP::Clang>(entry.compiler_command, entry.version,
+                                                      entry.macros);
+    } else {
+        return std::nullopt;
+    }
+
+    // Linker ids are the -fuse-ld= name with an ld. prefix. The number of
+    // jobs isn't cached, as it may be different for this configuration
+    std::unique_ptr<Linker::Linker> linker;
+    if (entry.linker.rfind("ld.", 0) != 0) {
+        return std::nullopt;
+    }
+    try {
+        linker = std::make_unique<Linker::Drivers::Gnu>(
+            Linker::from_fuse_ld(entry.linker.substr(3), comp->command), comp.get(),
+            entry.linker_selected, Util::pool().size());
+    } catch (const Util::Exceptions::InvalidArguments &) {
+        return std::nullopt;
+    }
+
+    std::unique_ptr<Archiver::Archiver> archiver;
+    if (entry.archiver == "gnu") {
+        archiver = std::make_unique<Archiver::Gnu>(entry.archiver_command);
+    } else if (!entry.archiver.empty()) {
+        return std::nullopt;
+    }
+
+    return Toolchain{std::move(comp), std::move(linker), std::move(archiver)};
+}
+
+Toolchain ToolchainCache::get(const Language & lang, const Machines::Machine & machine,
+                              const std::string & linker) {
+    const Key key{lang, machine};
+    {
+        std::lock_guard l{lock};
+        if (auto it = entries.find(key);
+            it != entries.end() && it->second.linker_option == linker) {
+            if (auto tc = create(it->second)) {
+                return std::move(tc.value());
+            }
+        }
+    }
+
+    ++miss_count;
+
+    // These must be taken before detection, so that a change made while it's
+    // running is seen by the next configuration
+    auto probes = probe_all(lang);
+    auto tc = get_toolchain(lang, machine, linker);
+
+    // The linker that was found is only known now. Linker ids are the name of
+    // its binary, ld.bfd, ld.gold, and so on
+    probes.emplace_back(probe(tc.linker->id()));
+
+    // Only GCC style drivers are detected currently
+    const auto * driver = dynamic_cast<const Linker::Drivers::Gnu *>(tc.linker.get());
+
+    Entry entry{tc.compiler->id(),
+                tc.compiler->version,
+                tc.compiler->command,
+                tc.compiler->macros,
+                tc.linker->id(),
+                driver != nullptr && driver->is_selected(),
+                linker,
+                tc.archiver != nullptr ? tc.archiver->id() : "",
+                tc.archiver != nullptr ? tc.archiver->command() : std::vector<std::string>{},
+                std::move(probes)};
+
+    std::lock_guard l{lock};
+    entries.insert_or_assign(key, std::move(entry));
+    return tc;
+}
+
+void ToolchainCache::load(const fs::path & file) {
+    std::ifstream in{file};
+    if (!in.is_open()) {
+        return;
+    }
+
+    std::string line{};
+    if (!std::getline(in, line) || line != CACHE_HEADER) {
+        return;
+    }
+    if (!std::getline(in, line) || line != environment) {
+        return;
+    }
+
+    std::map<Key, Entry> loaded{};
+    while (std::getline(in, line)) {
+        // toolchain <lang> <machine>, followed by the fields of the entry, and end
+        auto fields = split(line);
+        int machine;
+        if (fields.size() != 3 || fields[0] != "toolchain" ||
+            !(std::istringstream{fields[2]} >> machine)) {
+            return;
+        }
+        Language lang;
+        try {
+            lang = from_string(fields[1]);
+        } catch (...) {
+            return;
+        }
+
+        Entry entry{};
+        while (std::getline(in, line) && line != "end") {
+            fields = split(line);
+            if (fields.empty()) {
+                return;
+            }
+            const std::string & kind = fields[0];
+            if (kind == "compiler" && fields.size() >= 3) {
+                entry.compiler = fields[1];
+                entry.version = fields[2];
+                entry.compiler_command.assign(fields.begin() + 3, fields.end());
+            } else if (kind == "macro" && fields.size() >= 2) {
+                entry.macros.insert_or_assign(fields[1], fields.size() > 2 ? fields[2] : "");
+            } else if (kind == "linker" && (fields.size() == 3 || fields.size() == 4)) {
+                entry.linker = fields[1];
+                entry.linker_selected = fields[2] == "1";
+                entry.linker_option = fields.size() == 4 ? fields[3] : "";
+            } else if (kind == "archiver") {
+                if (fields.size() >= 2) {
+                    entry.archiver = fields[1];
+                    entry.archiver_command.assign(fields.begin() + 2, fields.end());
+                }
+            } else if (kind == "probe" && fields.size() >= 2) {
+                Probe p{fields[1], fields.size() > 2 ? fields[2] : ""};
+                if (fields.size() > 3 &&
+                    !(std::istringstream{fields[3]} >> p.dev >> p.ino >> p.mtime >> p.size)) {
+                    return;
+                }
+                entry.probes.emplace_back(std::move(p));
+            } else {
+                return;
+            }
+        }
+        if (line != "end") {
+            return;
+        }
+
+        // Anything that resolves differently now may detect differently
+        auto probes = probe_all(lang);
+        probes.emplace_back(probe(entry.linker));
+        if (entry.probes == probes) {
+            loaded.insert_or_assign(Key{lang, static_cast<Machines::Machine>(machine)},
+                                    std::move(entry));
+        }
+    }
+
+    std::lock_guard l{lock};
+    for (auto && [k, e] : loaded) {
+        entries.insert_or_assign(k, std::move(e));
+    }
+}
+
+void ToolchainCache::save(const fs::path & file) const {
+    // The environment is compared as a whole line, so only a newline matters
+    if (environment.find('\n') != std::string::npos) {
+        return;
+    }
+
+    std::error_code ec{};
+    fs::create_directories(file.parent_path(), ec);
+    if (ec) {
+        return;
+    }
+
+    // Write to a temporary and rename it, so that an interrupted write can't
+    // leave a truncated cache behind
+    const fs::path tmp = fs::path{file}.concat(".tmp");
+    {
+        std::ofstream out{tmp, std::ios::out | std::ios::trunc};
+        if (!out.is_open()) {
+            return;
+        }
+
+        std::lock_guard l{lock};
+        out << CACHE_HEADER << '\n' << environment << '\n';
+        for (const auto & [key, e] : entries) {
+            if (!serializable(e.version) || !serializable(e.compiler_command) ||
+                !serializable(e.linker_option) || !serializable(e.archiver_command)) {
+                continue;
+            }
+
+            const auto & [lang, machine] = key;
+            out << "toolchain\t" << to_string(lang) << '\t' << static_cast<int>(machine) << '\n';
+            out << "compiler\t" << e.compiler << '\t' << e.version;
+            write_fields(out, e.compiler_command);
+            for (const auto & [name, value] : e.macros) {
+                if (serializable(name) && serializable(value)) {
+                    out << "\nmacro\t" << name << '\t' << value;
+                }
+            }
+            out << "\nlinker\t" << e.linker << '\t' << (e.linker_selected ? 1 : 0) << '\t'
+                << e.linker_option << "\narchiver";
+            if (!e.archiver.empty()) {
+                out << '\t' << e.archiver;
+                write_fields(out, e.archiver_command);
+            }
+            out << '\n';
+            for (const auto & p : e.probes) {
+                out << "probe\t" << p.name << '\t' << p.path.string() << '\t' << p.dev << ' '
+                    << p.ino << ' ' << p.mtime << ' ' << p.size << '\n';
+            }
+            out << "end\n";
+        }
+        if (!out) {
+            return;
+        }
+    }
+    fs::rename(tmp, file, ec);
+}
+
+std::size_t ToolchainCache::misses() const { return miss_count; }
+
+} // namespace MIR::Toolchain
@@ -0,0 +1,111 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+/**
+ * A cache of detected toolchains, which persists across configurations
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "common.hpp"
+#include "machines.hpp"
+#include "toolchain.hpp"
+
+namespace MIR::Toolchain {
+
+/**
+ * Detects toolchains, remembering the results
+ *
+ * Detecting a toolchain runs the compiler, the linker (through the compiler),
+ * and the archiver. Everything detection learned is kept, including the
+ * compiler's predefined macros. The results can be written to disk, and on the
+ * next configuration loaded toolchains are used without running anything as
+ * long as:
+ *  - The environment variables that affect detection are the same
+ *  - The same linker was asked for
+ *  - Every candidate binary resolves to the same file in PATH, and that file
+ *    has the same inode, mtime, and size, or is still missing
+ *  - The same goes for `ld`, and the binary of the linker that was found
+ *
+ * Checking every candidate, and not just the one that was picked, means a
+ * more preferred binary being installed is noticed.
+ *
+ * Lookups are thread safe.
+ */
+class ToolchainCache {
+  public:
+    ToolchainCache();
+
+    /**
+     * Get the toolchain for a language and machine, detecting it if needed
+     *
+     * @param linker The linker option, as passed to `get_toolchain`
+     */
+    Toolchain get(const Language &, const Machines::Machine &, const std::string & linker = "");
+
+    /// Load the valid entries from a cache file, if there is one
+    void load(const std::filesystem::path & file);
+
+    /// Write the cache to a file, failing to do so is not an error
+    void save(const std::filesystem::path & file) const;
+
+    /// The number of lookups that had to run detection
+    std::size_t misses() const;
+
+  private:
+    /// Where a candidate binary resolves to, and enough to tell if it's changed
+    struct Probe {
+        std::string name;
+        std::filesystem::path path;
+        std::uint64_t dev = 0;
+        std::uint64_t ino = 0;
+        std::int64_t mtime = -1;
+        std::int64_t size = -1;
+
+        bool operator==(const Probe &) const;
+    };
+
+    /// Enough about a toolchain to recreate it without running anything
+    struct Entry {
+        std::string compiler;
+        std::string version;
+        std::vector<std::string> compiler_command;
+        std::unordered_map<std::string, std::string> macros;
+        std::string linker;
+        /// Whether the linker is passed to the compiler with `-fuse-ld=`
+        bool linker_selected = false;
+        /// The linker option detection was run with
+        std::string linker_option;
+        std::string archiver;
+        std::vector<std::string> archiver_command;
+        std::vector<Probe> probes;
+    };
+
+    using Key = std::tuple<Language, Machines::Machine>;
+
+    Probe probe(const std::string & name) const;
+    std::vector<Probe> probe_all(const Language &) const;
+    static std::optional<Toolchain> create(const Entry &);
+
+    /// The environment variables detection depends on, as a single line
+    const std::string environment;
+    const std::vector<std::filesystem::path> dirs;
+
+    mutable std::mutex lock;
+    std::map<Key, Entry> entries;
+
+    std::atomic_size_t miss_count{0};
+};
+
+} // namespace MIR::Toolchain
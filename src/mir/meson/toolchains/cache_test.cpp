@@ -0,0 +1,185 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+#include "cache.hpp"
+#include "test_directory.hpp"
+
+namespace fs = std::filesystem;
+namespace TC = MIR::Toolchain;
+
+namespace {
+
+/// Answers the probes that detection makes like GCC and binutils do
+const std::string FAKE_GCC = R"EOF(#!/bin/sh
+linker="GNU ld (GNU Binutils) 2.40"
+for arg in "$@"; do
+    case "$arg" in
+        -E) printf '#define __GNUC__ 12\n#define __GNUC_MINOR__ 2\n#define __GNUC_PATCHLEVEL__ 0\n';;
+        -fuse-ld=gold) linker="GNU gold (GNU Binutils 2.40) 1.16";;
+        -Wl,--version) echo "$linker";;
+    esac
+done
+)EOF";
+
+const std::string FAKE_AR = R"EOF(#!/bin/sh
+echo "GNU ar (GNU Binutils) 2.40"
+echo "Free Software Foundation"
+)EOF";
+
+class ToolchainCacheTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        // Only the fake tools can be found
+        const char * p = std::getenv("PATH");
+        old_path = p != nullptr ? p : "";
+        setenv("PATH", root.c_str(), 1);
+        unsetenv("CXX");
+        unsetenv("CXX_LD");
+
+        install("ar", FAKE_AR);
+    }
+
+    void TearDown() override {
+        setenv("PATH", old_path.c_str(), 1);
+        unsetenv("CXX");
+        unsetenv("CXX_LD");
+    }
+
+    void install(const std::string & name, const std::string & contents) {
+        std::ofstream{root / name} << contents;
+        fs::permissions(root / name, fs::perms::owner_all);
+    }
+
+    fs::path cache_file() const { return root / "toolchains.cache"; }
+
+    /// Detect in one configuration, and save the result
+    void first_run() {
+        TC::ToolchainCache cache{};
+        cache.load(cache_file());
+        cache.get(TC::Language::CPP, MIR::Machines::Machine::BUILD);
+        cache.save(cache_file());
+    }
+
+    const Util::TestDirectory tmp{};
+    const fs::path & root = tmp.path;
+    std::string old_path;
+};
+
+} // namespace
+
+TEST_F(ToolchainCacheTest, unchanged) {
+    install("c++", FAKE_GCC);
+    first_run();
+
+    TC::ToolchainCache cache{};
+    cache.load(cache_file());
+    const auto & tc = cache.get(TC::Language::CPP, MIR::Machines::Machine::BUILD);
+    ASSERT_EQ(cache.misses(), 0);
+    ASSERT_EQ(tc.compiler->id(), "gcc");
+    ASSERT_EQ(tc.compiler->version, "12.2.0");
+    ASSERT_EQ(tc.compiler->macros.at("__GNUC__"), "12");
+    ASSERT_EQ(tc.compiler->command, std::vector<std::string>{"c++"});
+    ASSERT_EQ(tc.linker->id(), "ld.bfd");
+    ASSERT_NE(tc.archiver, nullptr);
+    ASSERT_EQ(tc.archiver->command(), std::vector<std::string>{"ar"});
+}
+
+TEST_F(ToolchainCacheTest, in_memory) {
+    install("c++", FAKE_GCC);
+
+    TC::ToolchainCache cache{};
+    cache.get(TC::Language::CPP, MIR::Machines::Machine::BUILD);
+    cache.get(TC::Language::CPP, MIR::Machines::Machine::BUILD);
+    ASSERT_EQ(cache.misses(), 1);
+}
+
+TEST_F(ToolchainCacheTest, binary_changed) {
+    install("c++", FAKE_GCC);
+    first_run();
+    install("c++", FAKE_GCC + "# upgraded\n");
+
+    TC::ToolchainCache cache{};
+    cache.load(cache_file());
+    cache.get(TC::Language::CPP, MIR::Machines::Machine::BUILD);
+    ASSERT_EQ(cache.misses(), 1);
+}
+
+TEST_F(ToolchainCacheTest, preferred_installed) {
+    install("g++", FAKE_GCC);
+    first_run();
+    // c++ is preferred over g++, so it must be picked up
+    install("c++", FAKE_GCC);
+
+    TC::ToolchainCache cache{};
+    cache.load(cache_file());
+    const auto & tc = cache.get(TC::Language::CPP, MIR::Machines::Machine::BUILD);
+    ASSERT_EQ(cache.misses(), 1);
+    ASSERT_EQ(tc.compiler->command, std::vector<std::string>{"c++"});
+}
+
+TEST_F(ToolchainCacheTest, environment_changed) {
+    install("c++", FAKE_GCC);
+    first_run();
+    setenv("CXX", "c++", 1);
+
+    TC::ToolchainCache cache{};
+    cache.load(cache_file());
+    cache.get(TC::Language::CPP, MIR::Machines::Machine::BUILD);
+    ASSERT_EQ(cache.misses(), 1);
+}
+
+TEST_F(ToolchainCacheTest, linker_changed) {
+    install("c++", FAKE_GCC);
+    first_run();
+
+    TC::ToolchainCache cache{};
+    cache.load(cache_file());
+    const auto & tc = cache.get(TC::Language::CPP, MIR::Machines::Machine::BUILD, "gold");
+    ASSERT_EQ(cache.misses(), 1);
+    ASSERT_EQ(tc.linker->id(), "ld.gold");
+    ASSERT_EQ(tc.linker->always_args().front(), "-fuse-ld=gold");
+    cache.save(cache_file());
+
+    // The selection is remembered
+    TC::ToolchainCache again{};
+    again.load(cache_file());
+    const auto & tc2 = again.get(TC::Language::CPP, MIR::Machines::Machine::BUILD, "gold");
+    ASSERT_EQ(again.misses(), 0);
+    ASSERT_EQ(tc2.linker->id(), "ld.gold");
+    ASSERT_EQ(tc2.linker->always_args().front(), "-fuse-ld=gold");
+}
+
+TEST_F(ToolchainCacheTest, linker_binary_changed) {
+    install("c++", FAKE_GCC);
+    install("ld.bfd", "#!/bin/sh\n");
+    first_run();
+    install("ld.bfd", "#!/bin/sh\n# upgraded\n");
+
+    TC::ToolchainCache cache{};
+    cache.load(cache_file());
+    cache.get(TC::Language::CPP, MIR::Machines::Machine::BUILD);
+    ASSERT_EQ(cache.misses(), 1);
+}
+
+TEST_F(ToolchainCacheTest, default_linker_switched) {
+    install("c++", FAKE_GCC);
+    install("ld.bfd", "#!/bin/sh\n");
+    install("ld.gold", "#!/bin/sh\n");
+    fs::create_symlink("ld.bfd", root / "ld");
+    first_run();
+
+    // As update-alternatives would
+    fs::remove(root / "ld");
+    fs::create_symlink("ld.gold", root / "ld");
+
+    TC::ToolchainCache cache{};
+    cache.load(cache_file());
+    cache.get(TC::Language::CPP, MIR::Machines::Machine::BUILD);
+    ASSERT_EQ(cache.misses(), 1);
+}
@@ -0,0 +1,297 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <tuple>
+
+#include <unistd.h>
+
+#include "checks.hpp"
+#include "exceptions.hpp"
+#include "process.hpp"
+
+namespace MIR::Toolchain::Compiler {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/// A stable 64 bit FNV-1a hash, std::hash isn't guaranteed to be stable
+std::uint64_t hash(const std::string & s) {
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (const unsigned char c : s) {
+        h ^= c;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+std::string to_string(const CheckMode & m) {
+    switch (m) {
+        case CheckMode::PREPROCESS:
+            return "preprocess";
+        case CheckMode::COMPILE:
+            return "compile";
+        case CheckMode::LINK:
+            return "link";
+        case CheckMode::RUN:
+            return "run";
+    }
+    return "";
+}
+
+/// Create a new, empty, private directory to run a check in
+fs::path make_scratch_dir() {
+    static std::atomic_uint64_t count{0};
+    const fs::path dir = fs::temp_directory_path() / ("meson++-check-" + std::to_string(getpid()) +
+                                                      "-" + std::to_string(count++));
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    return dir;
+}
+
+/// Environment variables that change where compilers look for headers and libraries
+const std::vector<std::string> SEARCH_PATH_VARIABLES{
+    "CPATH", "C_INCLUDE_PATH", "CPLUS_INCLUDE_PATH", "LIBRARY_PATH", "LD_LIBRARY_PATH",
+};
+
+/**
+ * Run a check, returning the diagnostics from the compiler as well as the result
+ */
+std::tuple<CheckResult, std::string> run(const Compiler & comp, const Linker::Linker * linker,
+                                         const Check & check) {
+    const fs::path dir = make_scratch_dir();
+    const fs::path src = dir / ("check." + comp.source_suffix());
+    {
+        std::ofstream out{src};
+        out << check.code;
+    }
+
+    std::vector<std::string> cmd{comp.command};
+    const auto & always = comp.always_args();
+    cmd.insert(cmd.end(), always.begin(), always.end());
+    cmd.insert(cmd.end(), check.args.begin(), check.args.end());
+
+    fs::path output;
+    switch (check.mode) {
+        case CheckMode::PREPROCESS: {
+            output = dir / "output.i";
+            const auto & args = comp.preprocess_only_command();
+            cmd.insert(cmd.end(), args.begin(), args.end());
+            break;
+        }
+        case CheckMode::COMPILE: {
+            output = dir / "output.o";
+            const auto & args = comp.compile_only_command();
+            cmd.insert(cmd.end(), args.begin(), args.end());
+            break;
+        }
+        case CheckMode::LINK:
+        case CheckMode::RUN:
+            output = dir / "output.exe";
+            if (linker != nullptr) {
+                const auto & args = linker->always_args();
+                cmd.insert(cmd.end(), args.begin(), args.end());
+            }
+            break;
+    }
+    const auto & out_args = comp.output_command(output);
+    cmd.insert(cmd.end(), out_args.begin(), out_args.end());
+    cmd.emplace_back(src);
+
+    CheckResult result{false, ""};
+    std::string diagnostics{};
+    try {
+        const auto & [ret, out, err] = Util::process(cmd);
+        result.success = ret == 0;
+        diagnostics = err;
+        if (result.success && check.mode == CheckMode::RUN) {
+            const auto & [rret, rout, rerr] = Util::process({output});
+            result.success = rret == 0;
+            result.output = rout;
+        }
+    } catch (Util::Exceptions::MesonException &) {
+        // A compiler (or check program) that hangs or can't be run fails the check
+        result.success = false;
+    }
+
+    std::error_code ec{};
+    fs::remove_all(dir, ec);
+
+    return {result, diagnostics};
+}
+
+/// Run the checks at the given indexes of a group, writing into results
+void run_argument_group(const Compiler & comp, const std::vector<Check> & checks,
+                        std::vector<std::size_t> group, std::vector<CheckResult> & results) {
+    while (!group.empty()) {
+        Check combined{CheckMode::COMPILE, checks[group.front()].code, {}};
+        for (const auto & i : group) {
+            combined.args.insert(combined.args.end(), checks[i].args.begin(),
+                                 checks[i].args.end());
+        }
+
+        const auto & [result, diagnostics] = run(comp, nullptr, combined);
+        if (result.success) {
+            for (const auto & i : group) {
+                results[i] = CheckResult{true, ""};
+            }
+            return;
+        }
+        // A single check is run exactly as it would be on it's own
+        if (group.size() == 1) {
+            results[group.front()] = CheckResult{false, ""};
+            return;
+        }
+
+        const auto & unsupported = comp.unsupported_arguments(diagnostics);
+        std::vector<std::size_t> remaining{};
+        for (const auto & i : group) {
+            const auto & args = checks[i].args;
+            const bool rejected =
+                std::any_of(args.begin(), args.end(), [&](const std::string & a) {
+                    return std::find(unsupported.begin(), unsupported.end(), a) !=
+                           unsupported.end();
+                });
+            if (rejected) {
+                results[i] = CheckResult{false, ""};
+            } else {
+                remaining.emplace_back(i);
+            }
+        }
+
+        // If the failure couldn't be attributed to any argument split the
+        // group in half, and try each half
+        if (remaining.size() == group.size()) {
+            const auto mid = group.begin() + group.size() / 2;
+            run_argument_group(comp, checks, {group.begin(), mid}, results);
+            run_argument_group(comp, checks, {mid, group.end()}, results);
+            return;
+        }
+        group = std::move(remaining);
+    }
+}
+
+} // namespace
+
+std::string check_key(const Compiler & comp, const Linker::Linker * linker, const Check & check) {
+    std::ostringstream out{};
+    out << comp.id() << '\0' << comp.version << '\0';
+    for (const auto & c : comp.command) {
+        out << c << '\0';
+    }
+    if (linker != nullptr) {
+        const auto & args = linker->always_args();
+        out << linker->id() << '\0' << args.size() << '\0';
+        for (const auto & a : args) {
+            out << a << '\0';
+        }
+    }
+    for (const auto & name : SEARCH_PATH_VARIABLES) {
+        const char * value = std::getenv(name.c_str());
+        out << name << '=' << (value != nullptr ? value : "") << '\0';
+    }
+    out << to_string(check.mode) << '\0' << check.args.size() << '\0';
+    for (const auto & a : check.args) {
+        out << a << '\0';
+    }
+    out << check.code;
+    return out.str();
+}
+
+bool cacheable(const Check & check) {
+    if (check.mode != CheckMode::COMPILE || check.code.find("include") != std::string::npos) {
+        return false;
+    }
+    // Arguments can include files as well
+    return std::none_of(check.args.begin(), check.args.end(), [](const std::string & a) {
+        return a.compare(0, 8, "-include") == 0 || a.compare(0, 7, "-imacros") == 0;
+    });
+}
+
+CheckResult run_check(const Compiler & comp, const Linker::Linker * linker, const Check & check) {
+    return std::get<0>(run(comp, linker, check));
+}
+
+std::vector<CheckResult> run_argument_checks(const Compiler & comp,
+                                             const std::vector<Check> & checks) {
+    std::vector<CheckResult> results(checks.size(), CheckResult{false, ""});
+    std::vector<std::size_t> group(checks.size());
+    for (std::size_t i = 0; i < checks.size(); ++i) {
+        group[i] = i;
+    }
+    run_argument_group(comp, checks, std::move(group), results);
+    return results;
+}
+
+CheckCache::CheckCache(const fs::path & d) : dir{d} {}
+
+fs::path CheckCache::file(const std::string & key) const {
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash(key)));
+    return dir / name;
+}
+
+std::optional<CheckResult> CheckCache::get(const std::string & key) const {
+    std::ifstream in{file(key), std::ios::in | std::ios::binary};
+    if (!in.is_open()) {
+        return std::nullopt;
+    }
+    const std::string contents{std::istreambuf_iterator<char>{in},
+                               std::istreambuf_iterator<char>{}};
+
+    // <key size>\n<key><success>\n<output>
+    const auto nl = contents.find('\n');
+    if (nl == std::string::npos) {
+        return std::nullopt;
+    }
+    std::size_t size;
+    if (!(std::istringstream{contents.substr(0, nl)} >> size)) {
+        return std::nullopt;
+    }
+    const std::size_t start = nl + 1;
+    if (contents.size() < start + size + 2 || contents.compare(start, size, key) != 0) {
+        return std::nullopt;
+    }
+
+    const char success = contents[start + size];
+    if ((success != '0' && success != '1') || contents[start + size + 1] != '\n') {
+        return std::nullopt;
+    }
+    return CheckResult{success == '1', contents.substr(start + size + 2)};
+}
+
+void CheckCache::put(const std::string & key, const CheckResult & result) const {
+    std::error_code ec{};
+    fs::create_directories(dir, ec);
+    if (ec) {
+        return;
+    }
+
+    // Write to a private file then rename it, so that a reader never sees a
+    // partially written entry
+    const fs::path dest = file(key);
+    static std::atomic_uint64_t count{0};
+    const fs::path tmp = fs::path{dest}.concat("." + std::to_string(getpid()) + "." +
+                                               std::to_string(count++) + ".tmp");
+    {
+        std::ofstream out{tmp, std::ios::out | std::ios::trunc | std::ios::binary};
+        if (!out.is_open()) {
+            return;
+        }
+        out << key.size() << '\n' << key << (result.success ? '1' : '0') << '\n' << result.output;
+        if (!out) {
+            return;
+        }
+    }
+    fs::rename(tmp, dest, ec);
+}
+
+} // namespace MIR::Toolchain::Compiler
@@ -0,0 +1,120 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+/**
+ * Compiler checks, such as `compiler.has_header()`
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "compiler.hpp"
+#include "linker.hpp"
+
+namespace MIR::Toolchain::Compiler {
+
+/// How far a check goes
+enum class CheckMode {
+    /// Only run the preprocessor
+    PREPROCESS,
+    /// Compile but don't link
+    COMPILE,
+    /// Compile and link
+    LINK,
+    /// Compile, link, and run the result
+    RUN,
+};
+
+/// A single invocation of the compiler
+struct Check {
+    CheckMode mode;
+
+    /// The source to check
+    std::string code;
+
+    /// Extra arguments to pass to the compiler
+    std::vector<std::string> args;
+};
+
+struct CheckResult {
+    /// Whether the compiler (and the program, if run) succeeded
+    bool success;
+
+    /// The stdout of the program if it was run, otherwise empty
+    std::string output;
+};
+
+/**
+ * Get a string that identifies a check with a given compiler and linker
+ *
+ * This includes the compiler's id, version, and command, the linker's id and
+ * arguments, and the environment variables that change where the compiler
+ * looks for headers and libraries. It doesn't include the headers and
+ * libraries that are installed, see `cacheable()`.
+ *
+ * @param linker The linker used for LINK and RUN checks, may be null
+ */
+std::string check_key(const Compiler &, const Linker::Linker * linker, const Check &);
+
+/**
+ * Whether the result of a check may be stored in a CheckCache
+ *
+ * Only argument probes are, COMPILE checks of code that doesn't include
+ * anything, as their results depend only on what is in the key. Everything
+ * else depends on the headers and libraries installed on the system, which
+ * can change between one configuration and the next.
+ */
+bool cacheable(const Check &);
+
+/**
+ * Run a check, in a temporary directory
+ *
+ * This is safe to call from multiple threads at once.
+ *
+ * @param linker The linker for LINK and RUN checks, which are linked with it's
+ *               arguments, may be null
+ */
+CheckResult run_check(const Compiler &, const Linker::Linker * linker, const Check &);
+
+/**
+ * Run a group of argument checks, with as few invocations as possible
+ *
+ * Every check must be a COMPILE check of the same code, differing only in
+ * their arguments, such as those created from `Compiler::check_argument()`.
+ * All of the arguments are tried together first, and on failure the ones the
+ * compiler names as unsupported are removed. Only when a failure can't be
+ * attributed to an argument is the group split in half and each half tried
+ * again. A check that fails on it's own is run exactly as `run_check()` would
+ * run it, so the results are the same as running each check individually.
+ *
+ * This is safe to call from multiple threads at once.
+ */
+std::vector<CheckResult> run_argument_checks(const Compiler &, const std::vector<Check> &);
+
+/**
+ * A content addressed cache of check results
+ *
+ * Each result is stored in a file named after the hash of the check's key,
+ * along with the key itself to guard against collisions. Entries are never
+ * invalidated, so only checks that are `cacheable()` may be stored. Reads and
+ * writes are thread safe, and failing to write to the cache is not an error.
+ */
+class CheckCache {
+  public:
+    /// Create a cache in the given directory, which is created on first write
+    explicit CheckCache(const std::filesystem::path & dir);
+
+    std::optional<CheckResult> get(const std::string & key) const;
+    void put(const std::string & key, const CheckResult &) const;
+
+  private:
+    std::filesystem::path file(const std::string & key) const;
+
+    const std::filesystem::path dir;
+};
+
+} // namespace MIR::Toolchain::Compiler
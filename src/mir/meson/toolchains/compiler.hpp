@@ -9,11 +9,13 @@
 #include <filesystem>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "arguments.hpp"
 #include "common.hpp"
 #include "machines.hpp"
+#include "relative_paths.hpp"
 
 namespace MIR::Toolchain::Compiler {
 
@@ -71,10 +73,13 @@ class Compiler {
      * Convert a generic argument into a compiler specific one one
      *
      * @param arg The Argument to be converted
+     * @param paths Used to make paths relative, shared between calls so that
+     *              each directory is only resolved once
      */
     virtual std::vector<std::string> specialize_argument(const Arguments::Argument & arg,
                                                          const fs::path & src_dir,
-                                                         const fs::path & build_dir) const = 0;
+                                                         const fs::path & build_dir,
+                                                         Util::RelativePaths & paths) const = 0;
 
     /// Whether this compiler/language supports a given source type
     virtual CanCompileType supports_file(const std::string &) const = 0;
@@ -88,13 +93,55 @@ class Compiler {
     virtual std::vector<std::string> generate_depfile(const std::string & target_file,
                                                       const std::string & depfile) const = 0;
 
+    /// Get the command line arguments to preprocess only
+    virtual std::vector<std::string> preprocess_only_command() const = 0;
+
+    /// The file extension to use for sources generated by compiler checks
+    virtual std::string source_suffix() const = 0;
+
+    /**
+     * Get the arguments to use to check whether an argument is supported
+     *
+     * Some compilers silently accept some unknown arguments, so this may not
+     * be the argument itself.
+     *
+     * @param arg The argument to check
+     */
+    virtual std::vector<std::string> check_argument(const std::string & arg) const = 0;
+
+    /**
+     * Find the arguments that a failed invocation reported as unsupported
+     *
+     * This is used to probe many arguments with a single invocation, so only
+     * diagnostics that name a specific argument should be considered.
+     *
+     * @param output The diagnostics printed by the compiler
+     */
+    virtual std::vector<std::string> unsupported_arguments(const std::string & output) const = 0;
+
     /// Command to invoke this compiler, as a vector
     const std::vector<std::string> command;
 
+    /// The version string reported by the compiler, may be empty
+    const std::string version;
+
+    /**
+     * The macros the compiler predefines, name : value
+     *
+     * This is filled in by detection, and may be empty. Function-like macros
+     * are not included.
+     */
+    const std::unordered_map<std::string, std::string> macros;
+
   protected:
-    Compiler(const std::vector<std::string> & c) : command{c} {};
+    Compiler(const std::vector<std::string> & c, const std::string & v = "",
+             const std::unordered_map<std::string, std::string> & m = {})
+        : command{c}, version{v}, macros{m} {};
 }; // namespace std::filesystemclassCompiler
 
+/// The binaries tried for a language, in order of preference, when none are given
+const std::vector<std::string> & default_binaries(const Language &);
+
 std::unique_ptr<Compiler> detect_compiler(const Language &, const Machines::Machine &,
                                           const std::vector<std::string> & bins = {});
 
@@ -3,4 +3,15 @@
 
 #include "toolchains/compilers/cpp/cpp.hpp"
 
-namespace MIR::Toolchain::Compiler::CPP {} // namespace MIR::Toolchain::Compiler::CPP
+namespace MIR::Toolchain::Compiler::CPP {
+
+std::vector<std::string> Clang::check_argument(const std::string & arg) const {
+    // Clang only warns about arguments it doesn't know
+    auto args = GnuLike::check_argument(arg);
+    args.emplace_back("-Werror=unknown-warning-option");
+    args.emplace_back("-Werror=unused-command-line-argument");
+    args.emplace_back("-Werror=ignored-optimization-argument");
+    return args;
+}
+
+} // namespace MIR::Toolchain::Compiler::CPP
@@ -23,18 +23,27 @@ class GnuLike : public Compiler {
     Arguments::Argument generalize_argument(const std::string &) const final;
     std::vector<std::string> specialize_argument(const Arguments::Argument & arg,
                                                  const fs::path & src_dir,
-                                                 const fs::path & build_dir) const final;
+                                                 const fs::path & build_dir,
+                                                 Util::RelativePaths & paths) const final;
     std::vector<std::string> always_args() const final;
     CanCompileType supports_file(const std::string &) const final;
     std::vector<std::string> generate_depfile(const std::string &, const std::string &) const final;
+    std::vector<std::string> preprocess_only_command() const final;
+    std::string source_suffix() const final;
+    std::vector<std::string> check_argument(const std::string &) const override;
+    std::vector<std::string> unsupported_arguments(const std::string &) const final;
 
   protected:
-    GnuLike(const std::vector<std::string> & c) : Compiler{c} {};
+    GnuLike(const std::vector<std::string> & c, const std::string & v,
+            const std::unordered_map<std::string, std::string> & m)
+        : Compiler{c, v, m} {};
 };
 
 class Gnu : public GnuLike {
   public:
-    Gnu(const std::vector<std::string> & c) : GnuLike{c} {};
+    Gnu(const std::vector<std::string> & c, const std::string & v = "",
+        const std::unordered_map<std::string, std::string> & m = {})
+        : GnuLike{c, v, m} {};
     ~Gnu(){};
 
     std::string id() const override { return "gcc"; };
@@ -43,11 +52,14 @@ class Gnu : public GnuLike {
 
 class Clang : public GnuLike {
   public:
-    Clang(const std::vector<std::string> & c) : GnuLike{c} {};
+    Clang(const std::vector<std::string> & c, const std::string & v = "",
+          const std::unordered_map<std::string, std::string> & m = {})
+        : GnuLike{c, v, m} {};
     ~Clang(){};
 
     std::string id() const override { return "clang"; };
     std::string language() const override { return "C++"; };
+    std::vector<std::string> check_argument(const std::string &) const override;
 };
 
 } // namespace MIR::Toolchain::Compiler::CPP
@@ -1,12 +1,43 @@
 // SPDX-license-identifier: Apache-2.0
 // Copyright © 2021 Intel Corporation
 
+#include <optional>
+#include <sstream>
+
 #include "toolchains/compilers/cpp/cpp.hpp"
 
 namespace MIR::Toolchain::Compiler::CPP {
 
 namespace fs = std::filesystem;
 
+namespace {
+
+/**
+ * Get the quoted string starting at pos
+ *
+ * Which quotes are used depends on the locale, so this accepts ascii quotes
+ * as well as unicode ‘’.
+ */
+std::optional<std::string> get_quoted(const std::string & line, std::size_t pos) {
+    std::string close;
+    if (line.compare(pos, 1, "'") == 0 || line.compare(pos, 1, "\"") == 0) {
+        close = line.substr(pos, 1);
+        pos += 1;
+    } else if (line.compare(pos, 3, "\xe2\x80\x98") == 0) {
+        close = "\xe2\x80\x99";
+        pos += 3;
+    } else {
+        return std::nullopt;
+    }
+    const auto end = line.find(close, pos);
+    if (end == std::string::npos) {
+        return std::nullopt;
+    }
+    return line.substr(pos, end - pos);
+}
+
+} // namespace
+
 RSPFileSupport GnuLike::rsp_support() const { return RSPFileSupport::GCC; };
 std::vector<std::string> GnuLike::output_command(const std::string & output) const {
     return {"-o", output};
@@ -15,7 +46,11 @@ std::vector<std::string> GnuLike::compile_only_command() const { return {"-c"};
 
 Arguments::Argument GnuLike::generalize_argument(const std::string & arg) const {
     // XXX: this can't handle things like "-I foo"...
-    if (arg.substr(0, 2) == "-L") {
+    // A flag whose value is the next argument is passed through as is, rather
+    // than becoming an empty path
+    if (arg == "-L" || arg == "-D" || arg == "-l" || arg == "-I" || arg == "-isystem") {
+        return Arguments::Argument(arg, Arguments::Type::RAW);
+    } else if (arg.substr(0, 2) == "-L") {
         return Arguments::Argument(arg.substr(2, arg.size()), Arguments::Type::LINK_SEARCH);
     } else if (arg.substr(0, 2) == "-D") {
         return Arguments::Argument(arg.substr(2, arg.size()), Arguments::Type::DEFINE);
@@ -25,11 +60,11 @@ Arguments::Argument GnuLike::generalize_argument(const std::string & arg) const
         return Arguments::Argument(arg.substr(2, arg.size()), Arguments::Type::INCLUDE,
                                    Arguments::IncludeType::BASE);
     } else if (arg.substr(0, 8) == "-isystem") {
-        return Arguments::Argument(arg.substr(2, arg.size()), Arguments::Type::INCLUDE,
+        return Arguments::Argument(arg.substr(8, arg.size()), Arguments::Type::INCLUDE,
                                    Arguments::IncludeType::SYSTEM);
-    } else if (arg.substr(arg.length() - 2, arg.length()) == ".a") {
+    } else if (fs::path{arg}.extension() == ".a") {
         return Arguments::Argument(arg, Arguments::Type::LINK);
-    } else if (arg.substr(arg.length() - 2, arg.length()) == ".so") {
+    } else if (fs::path{arg}.extension() == ".so") {
         // TODO: or .so.X.Y.Z, .so.X.Y, .so.X
         return Arguments::Argument(arg, Arguments::Type::LINK);
     } else {
@@ -39,11 +74,16 @@ Arguments::Argument GnuLike::generalize_argument(const std::string & arg) const
 
 std::vector<std::string> GnuLike::specialize_argument(const Arguments::Argument & arg,
                                                       const fs::path & src_dir,
-                                                      const fs::path & build_dir) const {
+                                                      const fs::path & build_dir,
+                                                      Util::RelativePaths & paths) const {
     switch (arg.type) {
         case Arguments::Type::DEFINE:
             return {"-D", arg.value};
         case Arguments::Type::LINK:
+            // A path to a library is passed as is
+            if (arg.value.find('/') != std::string::npos) {
+                return {arg.value};
+            }
             return {"-l", arg.value};
         case Arguments::Type::LINK_SEARCH:
             return {"-L", arg.value};
@@ -55,12 +95,17 @@ std::vector<std::string> GnuLike::specialize_argument(const Arguments::Argument
                     inc_arg = "-I";
                     break;
                 case Arguments::IncludeType::SYSTEM:
-                    inc_arg = "-system";
+                    inc_arg = "-isystem";
                     break;
                 default:
                     throw std::exception{}; // Should be unreachable
             }
-            std::string b_inc = "'" + std::string{fs::relative(arg.value, build_dir)} + "'";
+            // Directories outside of the project, such as those from
+            // pkg-config, don't have a build and source version
+            if (fs::path{arg.value}.is_absolute()) {
+                return {inc_arg, arg.value};
+            }
+            std::string b_inc = "'" + paths.relative(arg.value, build_dir) + "'";
             if (b_inc == "''") {
                 b_inc = ".";
             }
@@ -68,7 +113,7 @@ std::vector<std::string> GnuLike::specialize_argument(const Arguments::Argument
             args.emplace_back(b_inc);
             args.emplace_back(inc_arg);
             // Needs to be relative to build dir
-            args.emplace_back(std::string{fs::relative(src_dir / arg.value, build_dir)});
+            args.emplace_back(paths.relative(src_dir / arg.value, build_dir));
             return args;
         }
         case Arguments::Type::RAW:
@@ -103,4 +148,47 @@ std::vector<std::string> GnuLike::generate_depfile(const std::string & target_fi
     return {"-MD", "-MQ", target_file, "-MF", depfile};
 }
 
+std::vector<std::string> GnuLike::preprocess_only_command() const { return {"-E"}; }
+
+std::string GnuLike::source_suffix() const { return "cpp"; }
+
+std::vector<std::string> GnuLike::check_argument(const std::string & arg) const {
+    // GCC silently accepts unknown -Wno- arguments, unless there are other
+    // warnings, so check for the positive form instead
+    if (arg.substr(0, 5) == "-Wno-") {
+        return {"-W" + arg.substr(5)};
+    }
+    return {arg};
+}
+
+std::vector<std::string> GnuLike::unsupported_arguments(const std::string & output) const {
+    static const std::vector<std::string> errors{
+        // GCC, and GCC before 10
+        "error: unrecognized command-line option ",
+        "error: unrecognized command line option ",
+        // Clang
+        "error: unknown warning option ",
+        "error: unknown argument: ",
+        "error: argument unused during compilation: ",
+        "error: optimization flag ",
+    };
+
+    std::vector<std::string> args{};
+    std::istringstream in{output};
+    std::string line;
+    while (std::getline(in, line)) {
+        for (const auto & e : errors) {
+            const auto pos = line.find(e);
+            if (pos == std::string::npos) {
+                continue;
+            }
+            if (const auto & arg = get_quoted(line, pos + e.size())) {
+                args.emplace_back(arg.value());
+            }
+            break;
+        }
+    }
+    return args;
+}
+
 } // namespace MIR::Toolchain::Compiler::CPP
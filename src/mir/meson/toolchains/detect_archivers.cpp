@@ -6,11 +6,13 @@
  */
 
 #include <cassert>
+#include <future>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "archiver.hpp"
+#include "exceptions.hpp"
 #include "process.hpp"
 
 namespace MIR::Toolchain::Archiver {
@@ -21,17 +23,35 @@ const std::vector<std::string> DEFAULT{"ar"};
 
 }
 
+const std::vector<std::string> & default_binaries() { return DEFAULT; }
+
 std::unique_ptr<Archiver> detect_archiver(const Machines::Machine & machine,
                                           const std::vector<std::string> & bins) {
     // TODO: handle the machine switch, and the cross/native file
-    for (const auto & c : bins.empty() ? DEFAULT : bins) {
-        auto const & [ret, out, err] = Util::process(std::vector<std::string>{c, "--version"});
+    const auto & candidates = bins.empty() ? DEFAULT : bins;
+
+    // Probe every candidate at once, and take the first that works in order
+    // of preference
+    std::vector<std::future<Util::Result>> probes{};
+    probes.reserve(candidates.size());
+    for (const auto & c : candidates) {
+        probes.emplace_back(Util::processes().submit({c, "--version"}));
+    }
+
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        Util::Result result;
+        try {
+            result = probes[i].get();
+        } catch (Util::Exceptions::ProcessTimeout &) {
+            continue;
+        }
+        const auto & [ret, out, err] = result;
         if (ret != 0) {
             continue;
         }
 
         if (out.find("Free Software Foundation") != std::string::npos) {
-            return std::make_unique<Gnu>(std::vector<std::string>{c});
+            return std::make_unique<Gnu>(std::vector<std::string>{candidates[i]});
         }
     }
     return nullptr;
@@ -4,6 +4,10 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdlib>
+
+#include <sys/wait.h>
+
 #include "archiver.hpp"
 
 TEST(detect_archivers, gnu) {
@@ -11,7 +15,7 @@ TEST(detect_archivers, gnu) {
     // getting the one we expect?
 
     // Skip if we don't have g++
-    if (system("ar") == 127) {
+    if (WEXITSTATUS(system("ar")) == 127) {
         GTEST_SKIP();
     }
     const auto comp =
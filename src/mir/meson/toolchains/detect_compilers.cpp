@@ -5,13 +5,18 @@
  * Compiler detection functions
  */
 
+#include <algorithm>
 #include <cassert>
+#include <future>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "compiler.hpp"
 #include "compilers/cpp/cpp.hpp"
+#include "exceptions.hpp"
 #include "process.hpp"
 
 namespace MIR::Toolchain::Compiler {
@@ -19,19 +24,101 @@ namespace MIR::Toolchain::Compiler {
 namespace {
 const std::vector<std::string> DEFAULT_CPP{"c++", "g++", "clang++"};
 
+/// Macros of compilers that also define the GCC or Clang ones, which aren't supported
+const std::vector<std::string> OTHER_VENDORS{
+    "__INTEL_COMPILER",      // icpc
+    "__INTEL_LLVM_COMPILER", // icpx
+    "__NVCOMPILER",          // nvc++
+    "__PGI",                 // pgc++, and older nvc++
+    "__ibmxl__",             // IBM XL, clang based
+    "__xlC__",               // IBM XL
+    "__ARMCC_VERSION",       // armclang
+    "__EMSCRIPTEN__",        // em++
+};
+
+using Macros = std::unordered_map<std::string, std::string>;
+
+/// Parse the output of `-E -dM`, ignoring function-like macros
+Macros parse_macros(const std::string & output) {
+    Macros macros{};
+    std::istringstream in{output};
+    std::string line{};
+    const std::string define = "#define ";
+    while (std::getline(in, line)) {
+        if (line.compare(0, define.size(), define) != 0) {
+            continue;
+        }
+        const auto name_end = line.find_first_of(" (", define.size());
+        if (name_end != std::string::npos && line[name_end] == '(') {
+            continue;
+        }
+        std::string name = line.substr(define.size(), name_end - define.size());
+        std::string value = name_end == std::string::npos ? "" : line.substr(name_end + 1);
+        macros.insert_or_assign(std::move(name), std::move(value));
+    }
+    return macros;
+}
+
+/// Join the values of version macros, ie, 12.2.0
+std::string macro_version(const Macros & macros, const std::vector<std::string> & names) {
+    std::string version{};
+    for (const auto & n : names) {
+        const auto & v = macros.find(n);
+        if (v == macros.end()) {
+            break;
+        }
+        version += (version.empty() ? "" : ".") + v->second;
+    }
+    return version;
+}
+
 std::unique_ptr<Compiler> detect_cpp_compiler(const Machines::Machine & m,
                                               const std::vector<std::string> & bins) {
     // TODO: handle the machine switch, and the cross/native file
+
+    // Dumping the predefined macros identifies the compiler, and gives us it's
+    // version, target, and type sizes, all from a single run.
+    //
+    // Probe every candidate at once, but take the first one that works in
+    // order of preference, so the result doesn't depend on which finishes first
+    std::vector<std::future<Util::Result>> probes{};
+    probes.reserve(bins.size());
     for (const auto & c : bins) {
-        auto const & [ret, out, err] = Util::process(std::vector<std::string>{c, "--version"});
+        probes.emplace_back(
+            Util::processes().submit({c, "-E", "-dM", "-x", "c++", "/dev/null"}));
+    }
+
+    for (std::size_t i = 0; i < bins.size(); ++i) {
+        Util::Result result;
+        try {
+            result = probes[i].get();
+        } catch (Util::Exceptions::ProcessTimeout &) {
+            continue;
+        }
+        const auto & [ret, out, err] = result;
         if (ret != 0) {
             continue;
         }
 
-        if (out.find("Free Software Foundation") != std::string::npos) {
-            return std::make_unique<CPP::Gnu>(std::vector<std::string>{c});
-        } else if (out.find("clang version") != std::string::npos) {
-            return std::make_unique<CPP::Clang>(std::vector<std::string>{c});
+        const std::vector<std::string> command{bins[i]};
+        auto macros = parse_macros(out);
+
+        // Plenty of compilers define the GCC or Clang macros for
+        // compatibility, so these have to be ruled out first
+        if (std::any_of(OTHER_VENDORS.begin(), OTHER_VENDORS.end(),
+                        [&](const std::string & v) { return macros.count(v) != 0; })) {
+            continue;
+        }
+
+        // Clang also defines the GCC macros, for compatibility
+        if (macros.count("__clang__")) {
+            const auto & version = macro_version(
+                macros, {"__clang_major__", "__clang_minor__", "__clang_patchlevel__"});
+            return std::make_unique<CPP::Clang>(command, version, std::move(macros));
+        } else if (macros.count("__GNUC__")) {
+            const auto & version =
+                macro_version(macros, {"__GNUC__", "__GNUC_MINOR__", "__GNUC_PATCHLEVEL__"});
+            return std::make_unique<CPP::Gnu>(command, version, std::move(macros));
         }
     }
     return nullptr;
@@ -39,11 +126,19 @@ std::unique_ptr<Compiler> detect_cpp_compiler(const Machines::Machine & m,
 
 } // namespace
 
+const std::vector<std::string> & default_binaries(const Language & lang) {
+    switch (lang) {
+        case Language::CPP:
+            return DEFAULT_CPP;
+    }
+    assert(false);
+}
+
 std::unique_ptr<Compiler> detect_compiler(const Language & lang, const Machines::Machine & machine,
                                           const std::vector<std::string> & bins) {
     switch (lang) {
         case Language::CPP:
-            return detect_cpp_compiler(machine, bins.empty() ? DEFAULT_CPP : bins);
+            return detect_cpp_compiler(machine, bins.empty() ? default_binaries(lang) : bins);
     }
     assert(false);
 };
@@ -4,11 +4,18 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+#include <sys/wait.h>
+
 #include "compiler.hpp"
+#include "test_directory.hpp"
 
 TEST(detect_compilers, g_plus_plus) {
     // Skip if we don't have g++
-    if (system("g++") == 127) {
+    if (WEXITSTATUS(system("g++")) == 127) {
         GTEST_SKIP();
     }
     const auto comp = MIR::Toolchain::Compiler::detect_compiler(
@@ -19,7 +26,7 @@ TEST(detect_compilers, g_plus_plus) {
 
 TEST(detect_compilers, clang_plus_plus) {
     // Skip if we don't have clang++
-    if (system("clang++") == 127) {
+    if (WEXITSTATUS(system("clang++")) == 127) {
         GTEST_SKIP();
     }
     const auto comp = MIR::Toolchain::Compiler::detect_compiler(
@@ -27,3 +34,63 @@ TEST(detect_compilers, clang_plus_plus) {
     ASSERT_NE(comp, nullptr);
     ASSERT_EQ(comp->id(), "clang");
 }
+
+TEST(detect_compilers, preference_order) {
+    // Skip if we don't have g++
+    if (WEXITSTATUS(system("g++")) == 127) {
+        GTEST_SKIP();
+    }
+    // All of the candidates are probed at once, but the first usable one in
+    // the list must win regardless of which answers first
+    const auto comp = MIR::Toolchain::Compiler::detect_compiler(
+        MIR::Toolchain::Language::CPP, MIR::Machines::Machine::BUILD,
+        {"this-compiler-does-not-exist", "g++", "c++"});
+    ASSERT_NE(comp, nullptr);
+    ASSERT_EQ(comp->command, std::vector<std::string>{"g++"});
+}
+
+TEST(detect_compilers, macros) {
+    // Skip if we don't have g++
+    if (WEXITSTATUS(system("g++")) == 127) {
+        GTEST_SKIP();
+    }
+    const auto comp = MIR::Toolchain::Compiler::detect_compiler(
+        MIR::Toolchain::Language::CPP, MIR::Machines::Machine::BUILD, {"g++"});
+    ASSERT_NE(comp, nullptr);
+    ASSERT_EQ(comp->version, comp->macros.at("__GNUC__") + "." +
+                                 comp->macros.at("__GNUC_MINOR__") + "." +
+                                 comp->macros.at("__GNUC_PATCHLEVEL__"));
+    ASSERT_EQ(comp->macros.count("__cplusplus"), 1);
+
+    const auto & info =
+        MIR::Machines::from_macros(MIR::Machines::Machine::BUILD, comp->macros);
+    ASSERT_TRUE(info.has_value());
+    ASSERT_EQ(info->cpu_family, MIR::Machines::detect_build().cpu_family);
+    ASSERT_EQ(info->endian, MIR::Machines::detect_build().endian);
+}
+
+TEST(detect_compilers, other_vendors) {
+    // icpc defines the GCC macros, and icpx the Clang ones, but they aren't
+    // either, so they must be passed over for the next candidate
+    const Util::TestDirectory tmp{};
+    const auto & dir = tmp.path;
+    const auto fake = [&](const std::string & name, const std::string & macros) {
+        std::ofstream{dir / name} << "#!/bin/sh\nprintf '" << macros << "'\n";
+        std::filesystem::permissions(dir / name, std::filesystem::perms::owner_all);
+        return (dir / name).string();
+    };
+    const auto icpc = fake("icpc", "#define __GNUC__ 12\\n#define __INTEL_COMPILER 2021\\n");
+    const auto icpx = fake("icpx", "#define __GNUC__ 4\\n#define __clang__ 1\\n"
+                                   "#define __INTEL_LLVM_COMPILER 20230000\\n");
+    const auto gcc = fake("gcc", "#define __GNUC__ 12\\n");
+
+    const auto comp = MIR::Toolchain::Compiler::detect_compiler(
+        MIR::Toolchain::Language::CPP, MIR::Machines::Machine::BUILD, {icpc, icpx, gcc});
+    const auto none = MIR::Toolchain::Compiler::detect_compiler(
+        MIR::Toolchain::Language::CPP, MIR::Machines::Machine::BUILD, {icpc, icpx});
+
+    ASSERT_NE(comp, nullptr);
+    ASSERT_EQ(comp->id(), "gcc");
+    ASSERT_EQ(comp->command, std::vector<std::string>{gcc});
+    ASSERT_EQ(none, nullptr);
+}
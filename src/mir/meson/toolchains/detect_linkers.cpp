@@ -5,7 +5,6 @@
  * Linker detection functions
  */
 
-#include <cassert>
 #include <memory>
 #include <string>
 #include <vector>
@@ -14,39 +13,74 @@
 #include "exceptions.hpp"
 #include "linker.hpp"
 #include "process.hpp"
+#include "thread_pool.hpp"
 
 namespace MIR::Toolchain::Linker {
 
 namespace {
 
 /**
- * Specialization for GCC (and G++, etc)
+ * Find which linker printed a version string
+ *
+ * mold claims to be compatible with GNU ld, so it has to be checked before bfd
  */
-std::unique_ptr<Linker> detect_linker_gcc(const std::unique_ptr<Compiler::Compiler> & comp,
-                                          const Machines::Machine & machine) {
+std::unique_ptr<GnuLike> from_version(const std::string & out,
+                                      const std::vector<std::string> & command) {
+    if (out.find("mold") != std::string::npos) {
+        return std::make_unique<Mold>(command);
+    } else if (out.find("LLD") != std::string::npos) {
+        return std::make_unique<LLD>(command);
+    } else if (out.find("GNU gold") != std::string::npos) {
+        return std::make_unique<GnuGold>(command);
+    } else if (out.find("GNU ld") != std::string::npos) {
+        return std::make_unique<GnuBFD>(command);
+    }
+    return nullptr;
+}
+
+/**
+ * Specialization for GCC compatible drivers (GCC and Clang)
+ */
+std::unique_ptr<Linker> detect_linker_gnulike(const std::unique_ptr<Compiler::Compiler> & comp,
+                                              const Machines::Machine & machine,
+                                              const std::string & requested) {
     auto command = comp->command;
+    if (!requested.empty()) {
+        // Check the name first, so that a typo isn't reported as a missing linker
+        from_fuse_ld(requested, comp->command);
+        command.emplace_back("-fuse-ld=" + requested);
+    }
     command.emplace_back("-Wl,--version");
+
     auto const & [ret, out, err] = Util::process(command);
-    // TODO: something smarter here
     if (ret != 0) {
+        if (!requested.empty()) {
+            throw Util::Exceptions::MesonException{"The " + comp->language() +
+                                                   " compiler cannot use the linker \"" +
+                                                   requested + "\""};
+        }
         throw Util::Exceptions::MesonException{"Failed to get linker verison"};
     }
 
-    if (out.find("GNU ld") != std::string::npos) {
-        GnuBFD linker{command};
-        return std::make_unique<Drivers::Gnu>(linker, comp.get());
+    auto linker = from_version(out, comp->command);
+    if (linker == nullptr) {
+        throw Util::Exceptions::MesonException{"Could not detect the linker used by " +
+                                               comp->command.front()};
     }
-    assert(false);
+    return std::make_unique<Drivers::Gnu>(std::move(linker), comp.get(), !requested.empty(),
+                                          Util::pool().size());
 };
 
 } // namespace
 
 std::unique_ptr<Linker> detect_linker(const std::unique_ptr<Compiler::Compiler> & comp,
-                                      const Machines::Machine & machine) {
-    if (comp->id() == "gcc") {
-        return detect_linker_gcc(comp, machine);
+                                      const Machines::Machine & machine,
+                                      const std::string & requested) {
+    if (comp->id() == "gcc" || comp->id() == "clang") {
+        return detect_linker_gnulike(comp, machine, requested);
     }
-    assert(false);
+    throw Util::Exceptions::MesonException{"Don't know how to detect a linker for the " +
+                                           comp->id() + " compiler"};
 };
 
 } // namespace MIR::Toolchain::Linker
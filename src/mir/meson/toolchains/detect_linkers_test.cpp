@@ -4,12 +4,17 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdlib>
+
+#include <sys/wait.h>
+
 #include "compiler.hpp"
+#include "exceptions.hpp"
 #include "linker.hpp"
 
 TEST(g_plus_plus, bfd) {
     // Skip if we don't have g++ or ld.bfd
-    if (system("g++") == 127 || system("ld.bfd") == 127) {
+    if (WEXITSTATUS(system("g++")) == 127 || WEXITSTATUS(system("ld.bfd")) == 127) {
         GTEST_SKIP();
     }
     const auto comp = MIR::Toolchain::Compiler::detect_compiler(
@@ -20,3 +25,37 @@ TEST(g_plus_plus, bfd) {
     ASSERT_NE(link, nullptr);
     ASSERT_EQ(link->id(), "ld.bfd");
 }
+
+TEST(g_plus_plus, gold) {
+    // Skip if we don't have g++ or ld.gold
+    if (WEXITSTATUS(system("g++")) == 127 || WEXITSTATUS(system("ld.gold")) == 127) {
+        GTEST_SKIP();
+    }
+    const auto comp = MIR::Toolchain::Compiler::detect_compiler(
+        MIR::Toolchain::Language::CPP, MIR::Machines::Machine::BUILD, {"g++"});
+    ASSERT_NE(comp, nullptr);
+
+    const auto link =
+        MIR::Toolchain::Linker::detect_linker(comp, MIR::Machines::Machine::BUILD, "gold");
+    ASSERT_NE(link, nullptr);
+    ASSERT_EQ(link->id(), "ld.gold");
+
+    const auto args = link->always_args();
+    ASSERT_EQ(args.size(), 3);
+    ASSERT_EQ(args[0], "-fuse-ld=gold");
+    ASSERT_EQ(args[1], "-Wl,--threads");
+    ASSERT_EQ(args[2].rfind("-Wl,--thread-count=", 0), 0);
+}
+
+TEST(g_plus_plus, unknown_linker) {
+    if (WEXITSTATUS(system("g++")) == 127) {
+        GTEST_SKIP();
+    }
+    const auto comp = MIR::Toolchain::Compiler::detect_compiler(
+        MIR::Toolchain::Language::CPP, MIR::Machines::Machine::BUILD, {"g++"});
+    ASSERT_NE(comp, nullptr);
+
+    ASSERT_THROW(
+        MIR::Toolchain::Linker::detect_linker(comp, MIR::Machines::Machine::BUILD, "ld.fake"),
+        Util::Exceptions::InvalidArguments);
+}
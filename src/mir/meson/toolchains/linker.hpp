@@ -48,12 +48,16 @@ class Linker {
     const std::vector<std::string> _command;
 };
 
-class GnuBFD : public Linker {
+/**
+ * Base for linkers that take GNU ld style arguments
+ *
+ * These are not called directly, but through a compiler driver, which can
+ * pick one of them with `-fuse-ld=`.
+ */
+class GnuLike : public Linker {
   public:
-    GnuBFD(const std::vector<std::string> & c) : Linker{c} {};
-    ~GnuBFD(){};
+    virtual ~GnuLike(){};
 
-    std::string id() const override { return "ld.bfd"; }
     RSPFileSupport rsp_support() const override final;
     std::string language() const final {
         throw std::exception{}; // "Should be unused"
@@ -63,32 +67,116 @@ class GnuBFD : public Linker {
     }
     const std::vector<std::string> command() const final { return _command; }
     std::vector<std::string> always_args() const final { return {}; }
+
+    /// The name of this linker, as passed to `-fuse-ld=`
+    virtual std::string fuse_ld() const = 0;
+
+    /**
+     * Get the arguments to link using a number of threads
+     *
+     * @param jobs The number of threads to use.
+     * @return The arguments, or an empty list if the linker doesn't support threads
+     */
+    virtual std::vector<std::string> thread_args(const std::size_t & jobs) const = 0;
+
+  protected:
+    GnuLike(const std::vector<std::string> & c) : Linker{c} {};
+};
+
+class GnuBFD : public GnuLike {
+  public:
+    GnuBFD(const std::vector<std::string> & c) : GnuLike{c} {};
+    ~GnuBFD(){};
+
+    std::string id() const override { return "ld.bfd"; }
+    std::string fuse_ld() const override { return "bfd"; }
+    std::vector<std::string> thread_args(const std::size_t & jobs) const override;
+};
+
+class GnuGold : public GnuLike {
+  public:
+    GnuGold(const std::vector<std::string> & c) : GnuLike{c} {};
+    ~GnuGold(){};
+
+    std::string id() const override { return "ld.gold"; }
+    std::string fuse_ld() const override { return "gold"; }
+    std::vector<std::string> thread_args(const std::size_t & jobs) const override;
 };
 
+class LLD : public GnuLike {
+  public:
+    LLD(const std::vector<std::string> & c) : GnuLike{c} {};
+    ~LLD(){};
+
+    std::string id() const override { return "ld.lld"; }
+    std::string fuse_ld() const override { return "lld"; }
+    std::vector<std::string> thread_args(const std::size_t & jobs) const override;
+};
+
+class Mold : public GnuLike {
+  public:
+    Mold(const std::vector<std::string> & c) : GnuLike{c} {};
+    ~Mold(){};
+
+    std::string id() const override { return "ld.mold"; }
+    std::string fuse_ld() const override { return "mold"; }
+    std::vector<std::string> thread_args(const std::size_t & jobs) const override;
+};
+
+/**
+ * Create a GNU style linker from the name used by `-fuse-ld=`
+ *
+ * @throws Util::Exceptions::InvalidArguments if the name isn't a known linker
+ */
+std::unique_ptr<GnuLike> from_fuse_ld(const std::string & name,
+                                      const std::vector<std::string> & command);
+
 namespace Drivers {
 
-// TODO: this might have to be a templateized class
+/**
+ * A GNU style linker, used through a GCC compatible compiler driver
+ *
+ * If the linker was explicitly selected it's passed to the driver with
+ * `-fuse-ld=`, otherwise the driver is left to use it's default linker.
+ */
 class Gnu : public Linker {
   public:
-    Gnu(const GnuBFD & l, const Compiler::Compiler * const c)
-        : Linker{{}}, linker{l}, compiler{c} {};
+    Gnu(std::unique_ptr<GnuLike> l, const Compiler::Compiler * const c,
+        const bool & selected = false, const std::size_t & jobs = 1)
+        : Linker{{}}, linker{std::move(l)}, compiler{c}, selected{selected}, jobs{jobs} {};
     ~Gnu(){};
 
-    std::string id() const override { return linker.id(); }
+    std::string id() const override { return linker->id(); }
     RSPFileSupport rsp_support() const override final;
     std::string language() const override;
     std::vector<std::string> output_command(const std::string & outfile) const override;
     const std::vector<std::string> command() const final { return compiler->command; }
-    std::vector<std::string> always_args() const final { return {}; }
+    std::vector<std::string> always_args() const final;
+
+    /// Whether the linker is passed to the driver with `-fuse-ld=`
+    bool is_selected() const { return selected; }
 
   private:
-    const GnuBFD linker;
+    const std::unique_ptr<GnuLike> linker;
     const Compiler::Compiler * const compiler;
+    const bool selected;
+
+    /// The number of threads the linker may use
+    const std::size_t jobs;
 };
 
 } // namespace Drivers
 
+/**
+ * Detect the linker used by a compiler
+ *
+ * @param comp The compiler to link with
+ * @param machine The machine to link for
+ * @param requested The `-fuse-ld=` name of the linker to use, or empty to use
+ *                  the compiler's default
+ */
 std::unique_ptr<Linker> detect_linker(const std::unique_ptr<Compiler::Compiler> & comp,
-                                      const Machines::Machine & machine);
+                                      const Machines::Machine & machine,
+                                      const std::string & requested = "");
 
 } // namespace MIR::Toolchain::Linker
@@ -5,10 +5,22 @@
 
 namespace MIR::Toolchain::Linker::Drivers {
 
-RSPFileSupport Gnu::rsp_support() const { return linker.rsp_support(); }
+RSPFileSupport Gnu::rsp_support() const { return linker->rsp_support(); }
 std::string Gnu::language() const { return compiler->language(); }
 std::vector<std::string> Gnu::output_command(const std::string & outfile) const {
     return compiler->output_command(outfile);
 }
 
+std::vector<std::string> Gnu::always_args() const {
+    std::vector<std::string> args{};
+    if (selected) {
+        args.emplace_back("-fuse-ld=" + linker->fuse_ld());
+    }
+    // The linker's own arguments have to be passed through the driver
+    for (const auto & a : linker->thread_args(jobs)) {
+        args.emplace_back("-Wl," + a);
+    }
+    return args;
+}
+
 } // namespace MIR::Toolchain::Linker::Drivers
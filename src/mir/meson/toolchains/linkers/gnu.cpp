@@ -1,10 +1,32 @@
 // SPDX-license-identifier: Apache-2.0
 // Copyright © 2021 Intel Corporation
 
+#include "exceptions.hpp"
 #include "toolchains/linker.hpp"
 
 namespace MIR::Toolchain::Linker {
 
-RSPFileSupport GnuBFD::rsp_support() const { return RSPFileSupport::GCC; };
+RSPFileSupport GnuLike::rsp_support() const { return RSPFileSupport::GCC; };
+
+std::vector<std::string> GnuBFD::thread_args(const std::size_t &) const { return {}; }
+
+std::vector<std::string> GnuGold::thread_args(const std::size_t & jobs) const {
+    return {"--threads", "--thread-count=" + std::to_string(jobs)};
+}
+
+std::unique_ptr<GnuLike> from_fuse_ld(const std::string & name,
+                                      const std::vector<std::string> & command) {
+    if (name == "bfd") {
+        return std::make_unique<GnuBFD>(command);
+    } else if (name == "gold") {
+        return std::make_unique<GnuGold>(command);
+    } else if (name == "lld") {
+        return std::make_unique<LLD>(command);
+    } else if (name == "mold") {
+        return std::make_unique<Mold>(command);
+    }
+    throw Util::Exceptions::InvalidArguments{"Unknown linker \"" + name +
+                                             "\", must be one of bfd, gold, lld, or mold"};
+}
 
 } // namespace MIR::Toolchain::Linker
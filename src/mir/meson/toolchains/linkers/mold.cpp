@@ -0,0 +1,12 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include "toolchains/linker.hpp"
+
+namespace MIR::Toolchain::Linker {
+
+std::vector<std::string> Mold::thread_args(const std::size_t & jobs) const {
+    return {"--thread-count=" + std::to_string(jobs)};
+}
+
+} // namespace MIR::Toolchain::Linker
@@ -1,19 +1,59 @@
 // SPDX-license-identifier: Apache-2.0
 // Copyright © 2021 Intel Corporation
 
+#include <cstdlib>
+
 #include "toolchain.hpp"
 #include "archiver.hpp"
 #include "compiler.hpp"
+#include "exceptions.hpp"
 #include "linker.hpp"
+#include "thread_pool.hpp"
 
 namespace MIR::Toolchain {
 
-Toolchain get_toolchain(const Language & lang, const Machines::Machine & for_machine) {
+namespace {
+
+/// The environment variable that selects the linker for a language
+std::string linker_env(const Language & lang) {
+    switch (lang) {
+        case Language::CPP:
+            return "CXX_LD";
+        default:
+            // TODO: unreachable
+            throw Util::Exceptions::MesonException{"This shouldn't be reachable"};
+    }
+}
+
+} // namespace
+
+Toolchain get_toolchain(const Language & lang, const Machines::Machine & for_machine,
+                        const std::string & linker_option) {
     // TODO: handle passing in explicit binary name
+
+    // The archiver doesn't depend on the compiler, so look for it while the
+    // compiler is being detected. The linker is found through the compiler,
+    // so it has to wait for it.
+    auto archiver =
+        Util::pool().submit([for_machine]() { return Archiver::detect_archiver(for_machine); });
+
     auto compiler = Compiler::detect_compiler(lang, for_machine);
-    auto archiver = Archiver::detect_archiver(for_machine);
-    auto linker = Linker::detect_linker(compiler, for_machine);
-    return Toolchain{std::move(compiler), std::move(linker), std::move(archiver)};
+    if (compiler == nullptr) {
+        throw Util::Exceptions::MesonException{"Could not find a " + to_string(lang) +
+                                               " compiler"};
+    }
+
+    // The option takes precedence over the environment
+    std::string requested = linker_option;
+    if (requested.empty()) {
+        if (const char * env = std::getenv(linker_env(lang).c_str()); env != nullptr) {
+            requested = env;
+        }
+    }
+    auto linker = Linker::detect_linker(compiler, for_machine, requested);
+
+    Util::pool().wait(archiver);
+    return Toolchain{std::move(compiler), std::move(linker), archiver.get()};
 };
 
 } // namespace MIR::Toolchain
@@ -35,6 +35,14 @@ class Toolchain {
     std::unique_ptr<Archiver::Archiver> archiver;
 };
 
-Toolchain get_toolchain(const Language & l, const Machines::Machine &);
+/**
+ * Detect the toolchain for a language
+ *
+ * @param linker The linker to use, by its `-fuse-ld=` name. If this is empty
+ *               the linker in the language's environment variable (such as
+ *               `CXX_LD`) is used, and if that isn't set the compiler's default
+ */
+Toolchain get_toolchain(const Language & l, const Machines::Machine &,
+                        const std::string & linker = "");
 
 } // namespace MIR::Toolchain
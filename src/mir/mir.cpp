@@ -1,6 +1,8 @@
 // SPDX-license-identifier: Apache-2.0
 // Copyright © 2021 Intel Corporation
 
+#include <atomic>
+
 #include "mir.hpp"
 #include "exceptions.hpp"
 
@@ -8,7 +10,8 @@ namespace MIR {
 
 namespace {
 
-static uint32_t bb_index = 0;
+// Atomic, as blocks may be created while other blocks are being lowered
+static std::atomic_uint32_t bb_index = 0;
 
 }
 
@@ -123,18 +126,20 @@ std::ostream & operator<<(std::ostream & os, const File & f) {
 
 Executable::Executable(const std::string & name_, const std::vector<Source> & srcs,
                        const Machines::Machine & m, const fs::path & sdir, const ArgMap & args,
-                       const std::vector<StaticLinkage> s_link, const Variable & v)
+                       const std::vector<StaticLinkage> s_link,
+                       const std::vector<Arguments::Argument> & link_args, const Variable & v)
     : name{name_}, sources{srcs}, machine{m}, subdir{sdir}, arguments{args},
-      link_static{s_link}, var{v} {};
+      link_static{s_link}, link_arguments{link_args}, var{v} {};
 
 std::string Executable::output() const { return name; }
 
 StaticLibrary::StaticLibrary(const std::string & name_, const std::vector<Source> & srcs,
                              const Machines::Machine & m, const fs::path & sdir,
                              const ArgMap & args, const std::vector<StaticLinkage> s_link,
+                             const std::vector<Arguments::Argument> & link_args,
                              const Variable & v)
     : name{name_}, sources{srcs}, machine{m}, subdir{sdir}, arguments{args},
-      link_static{s_link}, var{v} {};
+      link_static{s_link}, link_arguments{link_args}, var{v} {};
 
 std::string StaticLibrary::output() const { return name + ".a"; }
 
@@ -195,7 +200,9 @@ CustomTarget::CustomTarget(const std::string & n, const std::vector<Source> & i,
     : name{n}, inputs{i}, outputs{o}, command{c}, subdir{s}, var{v} {};
 
 Dependency::Dependency(const std::string & n, const bool & f, const std::string & ver,
-                       const std::vector<Arguments::Argument> & a, const Variable & v)
-    : name{n}, found{f}, version{ver}, arguments{a}, var{v} {};
+                       const std::vector<Arguments::Argument> & a,
+                       const std::vector<Arguments::Argument> & l, const DependencyType & t,
+                       const Variable & v)
+    : name{n}, found{f}, version{ver}, arguments{a}, link_arguments{l}, type{t}, var{v} {};
 
 } // namespace MIR
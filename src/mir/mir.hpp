@@ -129,7 +129,8 @@ class Executable {
   public:
     Executable(const std::string & name_, const std::vector<Source> & srcs,
                const Machines::Machine & m, const fs::path & sdir, const ArgMap & args,
-               const std::vector<StaticLinkage> s_link, const Variable & v);
+               const std::vector<StaticLinkage> s_link,
+               const std::vector<Arguments::Argument> & link_args, const Variable & v);
 
     /// The name of the target
     const std::string name;
@@ -154,6 +155,9 @@ class Executable {
     /// static targets to link with
     const std::vector<StaticLinkage> link_static{};
 
+    /// Arguments to pass to the linker, from dependencies
+    const std::vector<Arguments::Argument> link_arguments{};
+
     Variable var;
 
     std::string output() const;
@@ -163,7 +167,8 @@ class StaticLibrary {
   public:
     StaticLibrary(const std::string & name_, const std::vector<Source> & srcs,
                   const Machines::Machine & m, const fs::path & sdir, const ArgMap & args,
-                  const std::vector<StaticLinkage> s_link, const Variable & v);
+                  const std::vector<StaticLinkage> s_link,
+                  const std::vector<Arguments::Argument> & link_args, const Variable & v);
 
     /// The name of the target
     const std::string name;
@@ -188,6 +193,9 @@ class StaticLibrary {
     /// static targets to link with
     const std::vector<StaticLinkage> link_static{};
 
+    /// Arguments to pass to the linker, from dependencies
+    const std::vector<Arguments::Argument> link_arguments{};
+
     Variable var;
 
     std::string output() const;
@@ -225,7 +233,11 @@ class IncludeDirectories {
 };
 
 enum class DependencyType {
+    /// Created by declare_dependency()
     INTERNAL,
+
+    /// Found with pkg-config
+    PKGCONFIG,
 };
 
 /**
@@ -236,7 +248,9 @@ enum class DependencyType {
 class Dependency {
   public:
     Dependency(const std::string & name, const bool & found, const std::string & version,
-               const std::vector<Arguments::Argument> & args, const Variable & var);
+               const std::vector<Arguments::Argument> & args,
+               const std::vector<Arguments::Argument> & link_args, const DependencyType & type,
+               const Variable & var);
 
     /// Name of the dependency
     const std::string name;
@@ -250,6 +264,9 @@ class Dependency {
     /// Per-language compiler args
     const std::vector<Arguments::Argument> arguments;
 
+    /// Arguments to pass to the linker
+    const std::vector<Arguments::Argument> link_arguments;
+
     /// The kind of dependency this is
     const DependencyType type = DependencyType::INTERNAL;
 
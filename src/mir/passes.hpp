@@ -7,11 +7,15 @@
 
 #pragma once
 
+#include <future>
 #include <map>
+#include <optional>
 
 #include "machines.hpp"
 #include "mir.hpp"
+#include "pkgconfig.hpp"
 #include "state/state.hpp"
+#include "toolchains/checks.hpp"
 #include "toolchains/toolchain.hpp"
 
 namespace MIR::Passes {
@@ -89,10 +93,40 @@ bool usage_numbering(BasicBlock *, LastSeenTable &);
 
 /**
  * Insert phi nodes along dominance frontiers
+ *
+ * Unlike most passes this is not a per-block pass, it must be passed the root
+ * of the CFG, after value numbering has been done on all blocks. Phis are
+ * placed on the iterated dominance frontier of each definition, calculated in
+ * a single pass over the CFG.
  */
 bool insert_phis(BasicBlock *, ValueTable &);
+
+/**
+ * Replace phis which only have one reachable value with an Identifier
+ */
 bool fixup_phis(BasicBlock *);
 
+/**
+ * Sparse conditional constant propagation
+ *
+ * Like insert_phis this is a whole CFG pass, and must be passed the root. It
+ * walks only the blocks that are reachable given the conditions it has been
+ * able to resolve so far, folding `==`, `!=`, `not`, `string.version_compare()`
+ * and `dependency.found()` as it goes, and replaces any conditions it
+ * resolves with a Boolean so that branch_pruning can remove the dead arms.
+ */
+bool sccp(BasicBlock *);
+
+/**
+ * Replace duplicate calls to pure builtins with the first result
+ *
+ * Calls to `files()`, `include_directories()`, and `declare_dependency()` with
+ * the same reduced arguments in the same source directory are replaced with
+ * an Identifier pointing to the first call, as long as that call dominates the
+ * duplicate. This is a whole CFG pass, and requires value numbering.
+ */
+bool common_subexpression_elimination(BasicBlock *);
+
 using ReplacementTable = std::map<Variable, Variable>;
 
 bool constant_folding(BasicBlock *, ReplacementTable &);
@@ -105,29 +139,189 @@ using PropTable = std::map<Variable, Object *>;
 bool constant_propogation(BasicBlock *, PropTable &);
 
 /**
- * Do work that can be more optimally handled in threads.
+ * How the passes that replace calls with the results of background lookups
+ * (find_program(), dependency(), and compiler checks) use them
+ */
+enum class LookupMode {
+    /// Only replace calls whose lookups have already finished
+    POLL,
+
+    /// Wait for lookups to finish, and replace the calls that succeeded
+    WAIT,
+
+    /**
+     * Wait for lookups to finish, and raise errors for those that failed
+     *
+     * A failure, such as a required program that wasn't found, may be in a
+     * branch that is pruned once other lookups are used. This must only be
+     * used once a round of lowering, including pruning, makes no progress.
+     */
+    FINAL,
+};
+
+/**
+ * find_program() lookups, which are run on the thread pool
+ *
+ * Lookups are started as soon as a call's arguments are reduced, even if the
+ * block it's in hasn't been proven to be live yet, and the results are picked
+ * up by later rounds of lowering. This is only used from the lowering thread.
+ */
+class ProgramFinder {
+  public:
+    explicit ProgramFinder(std::shared_ptr<Util::ProgramCache> cache);
+
+    /// Start looking for the first of a list of names, unless we already are
+    void start(const std::vector<std::string> & names);
+
+    /**
+     * Get the result of a lookup that has been started
+     *
+     * If `wait` is false and the lookup hasn't finished, returns std::nullopt.
+     * An empty path means that none of the names were found.
+     */
+    std::optional<fs::path> get(const std::vector<std::string> & names, bool wait);
+
+  private:
+    struct Lookup {
+        std::shared_future<fs::path> result;
+        bool reported = false;
+    };
+
+    std::unordered_map<std::string, Lookup> lookups;
+
+    std::shared_ptr<Util::ProgramCache> cache;
+};
+
+/**
+ * Start find_program() lookups, and replace calls with the results
+ *
+ * Calls whose lookup hasn't finished are left alone when polling. A required
+ * program that wasn't found is only an error in the final mode.
+ */
+bool find_programs(BasicBlock *, State::Persistant &, ProgramFinder &, LookupMode);
+
+/**
+ * dependency() lookups, which are run on the thread pool
  *
- * Examples of this are:
- *  - dependencies
- *  - find_programs
- *  - compiler checks
+ * Dependencies are found by reading pkg-config files in process, rather than
+ * by running pkg-config. Like the ProgramFinder lookups are started as soon as
+ * a call's arguments are reduced, and picked up by later rounds of lowering.
+ * This is only used from the lowering thread.
+ */
+class DependencyFinder {
+  public:
+    explicit DependencyFinder(
+        const std::vector<fs::path> & search_path = PkgConfig::default_search_path());
+
+    /// The result of a lookup
+    struct Result {
+        /// nullptr if the dependency, or one of it's requirements, wasn't found
+        std::shared_ptr<const PkgConfig::Package> package;
+        /// Why it couldn't be used, if a .pc file is broken
+        std::string error;
+    };
+
+    /// Start looking for a dependency, unless we already are
+    void start(const std::string & name, bool static_);
+
+    /**
+     * Get the result of a lookup that has been started
+     *
+     * If `wait` is false and the lookup hasn't finished, returns std::nullopt.
+     * Broken .pc files are reported in the result, and not thrown, as the
+     * lookup may be for an optional dependency, or in code that is never run.
+     */
+    std::optional<Result> get(const std::string & name, bool static_, bool wait);
+
+  private:
+    std::shared_ptr<const PkgConfig::Resolver> resolver;
+    std::unordered_map<std::string, std::shared_future<Result>> lookups;
+};
+
+/**
+ * Start dependency() lookups, and replace calls with the results
  *
- * These can be done in parallel, using the cache
+ * Calls whose lookup hasn't finished are left alone when polling. A required
+ * dependency that wasn't found is only an error in the final mode.
  */
-bool threaded_lowering(BasicBlock *, State::Persistant & pstate);
+bool find_dependencies(BasicBlock *, const State::Persistant &, DependencyFinder &, LookupMode);
+
+/**
+ * Compiler checks, which are run on the thread pool
+ *
+ * Like the ProgramFinder checks are started as soon as their arguments are
+ * reduced, and picked up by later rounds of lowering. The results of argument
+ * probes are stored in a content addressed cache, so that they can be reused
+ * by later configurations. This is only used from the lowering thread.
+ */
+class CompilerChecker {
+  public:
+    explicit CompilerChecker(const fs::path & cache_dir);
+
+    /// Start a check, unless it has already been started
+    void start(const std::shared_ptr<Toolchain::Toolchain> &, const Toolchain::Compiler::Check &);
+
+    /**
+     * Start a group of argument checks, which are run together
+     *
+     * See `Toolchain::Compiler::run_argument_checks()`, the results are cached
+     * and retrieved individually, exactly like checks started one at a time.
+     */
+    void start(const std::shared_ptr<Toolchain::Toolchain> &,
+               const std::vector<Toolchain::Compiler::Check> &);
+
+    /**
+     * Get the result of a check that has been started
+     *
+     * If `wait` is false and the check hasn't finished, returns std::nullopt.
+     */
+    std::optional<Toolchain::Compiler::CheckResult>
+    get(const Toolchain::Toolchain &, const Toolchain::Compiler::Check &, bool wait);
+
+  private:
+    /// A started check, which is one of the results of a job
+    struct Pending {
+        std::shared_future<std::vector<Toolchain::Compiler::CheckResult>> results;
+        std::size_t index;
+    };
+
+    std::shared_ptr<const Toolchain::Compiler::CheckCache> cache;
+    std::unordered_map<std::string, Pending> checks;
+};
+
+/**
+ * Start compiler checks, and replace calls with the results
+ *
+ * This handles the compiler methods that need to run the compiler, such as
+ * `has_header()`, `compiles()`, and `sizeof()`. Calls whose checks haven't
+ * finished are left alone when polling. A check whose result is an error,
+ * like the `alignment()` of an unknown type, is only an error in the final
+ * mode.
+ */
+bool compiler_checks(BasicBlock *, CompilerChecker &, LookupMode);
 
 /**
  * Lower Program objects and their methods
  */
-bool lower_program_objects(BasicBlock &, State::Persistant & pstate);
+bool lower_program_objects(BasicBlock &, const State::Persistant & pstate);
 
 /// Lower string object methods
-bool lower_string_objects(BasicBlock & block, State::Persistant & pstate);
+bool lower_string_objects(BasicBlock & block, const State::Persistant & pstate);
 
 /// Lower dependency object methods
-bool lower_dependency_objects(BasicBlock & block, State::Persistant & pstate);
+bool lower_dependency_objects(BasicBlock & block, const State::Persistant & pstate);
 
 /// Delete any code that has become unreachable
 bool delete_unreachable(BasicBlock & block);
 
+/**
+ * Delete values that are never read
+ *
+ * This is a whole program pass, and is meant to be run once lowering is
+ * complete, so that the backend doesn't have to walk over (and we don't have to
+ * hold on to) values that have already been propagated into their users.
+ * Targets, custom targets, and messages are always kept.
+ */
+bool delete_dead_values(BasicBlock * block);
+
 } // namespace MIR::Passes
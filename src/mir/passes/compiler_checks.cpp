@@ -0,0 +1,478 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <unordered_map>
+
+#include "argument_extractors.hpp"
+#include "exceptions.hpp"
+#include "log.hpp"
+#include "passes.hpp"
+#include "private.hpp"
+#include "thread_pool.hpp"
+
+namespace MIR::Passes {
+
+namespace TC = Toolchain::Compiler;
+
+namespace {
+
+/**
+ * The checks a method needs, and how to turn their results into a value
+ *
+ * The result callback is only called once all of the checks have completed,
+ * and is responsible for reporting the result to the user.
+ */
+struct Request {
+    std::vector<TC::Check> checks;
+    std::function<Object(const std::vector<TC::CheckResult> &)> result;
+
+    /// The checks are argument checks, which can be run as a single group
+    bool batch = false;
+};
+
+std::string yes_no(bool b) { return b ? Util::Log::green("YES") : Util::Log::red("NO"); }
+
+std::string get_prefix(const FunctionCall & f) {
+    const auto & p = extract_keyword_argument<std::shared_ptr<String>>(f.kw_args, "prefix");
+    return p ? p.value()->value + "\n" : "";
+}
+
+std::vector<std::string> get_args(const FunctionCall & f) {
+    std::vector<std::string> args{};
+    for (const auto & a : extract_keyword_argument_a<std::shared_ptr<String>>(f.kw_args, "args")) {
+        args.emplace_back(a->value);
+    }
+    return args;
+}
+
+std::string get_string(const FunctionCall & f, const std::string & method) {
+    if (f.pos_args.size() != 1) {
+        throw Util::Exceptions::InvalidArguments("compiler." + method +
+                                                 "(): takes exactly one positional argument");
+    }
+    const auto & s = extract_positional_argument<std::shared_ptr<String>>(f.pos_args[0]);
+    if (!s) {
+        throw Util::Exceptions::InvalidArguments("compiler." + method +
+                                                 "(): first argument must be a string");
+    }
+    return s.value()->value;
+}
+
+/// Get the code for compiles() and links(), which may be a string or a file
+std::string get_code(const FunctionCall & f) {
+    if (f.pos_args.size() != 1) {
+        throw Util::Exceptions::InvalidArguments("compiler." + f.name +
+                                                 "(): takes exactly one positional argument");
+    }
+    const auto & code =
+        extract_positional_argument_v<std::shared_ptr<String>, std::shared_ptr<File>>(
+            f.pos_args[0]);
+    if (std::holds_alternative<std::shared_ptr<String>>(code)) {
+        return std::get<std::shared_ptr<String>>(code)->value;
+    } else if (std::holds_alternative<std::shared_ptr<File>>(code)) {
+        const auto & file = *std::get<std::shared_ptr<File>>(code);
+        if (file.is_built()) {
+            throw Util::Exceptions::InvalidArguments("compiler." + f.name +
+                                                     "(): cannot use a built file");
+        }
+        std::ifstream in{file.source_root / file.relative_to_source_dir()};
+        if (!in.is_open()) {
+            throw Util::Exceptions::MesonException("compiler." + f.name + "(): could not read " +
+                                                   file.get_name());
+        }
+        return std::string{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    }
+    throw Util::Exceptions::InvalidArguments("compiler." + f.name +
+                                             "(): first argument must be a string or file");
+}
+
+/// Get a number from a program that printed one
+int64_t get_number(const TC::CheckResult & r) {
+    if (!r.success) {
+        return -1;
+    }
+    try {
+        return std::stoll(r.output);
+    } catch (std::exception &) {
+        return -1;
+    }
+}
+
+Request has_header(const FunctionCall & f, const TC::Compiler &) {
+    const auto & header = get_string(f, f.name);
+    return Request{
+        {TC::Check{TC::CheckMode::PREPROCESS, get_prefix(f) + "#include <" + header + ">\n",
+                   get_args(f)}},
+        [header](const auto & r) {
+            std::cout << "Has header \"" << header << "\" : " << yes_no(r[0].success) << std::endl;
+            return std::make_shared<Boolean>(r[0].success);
+        }};
+}
+
+Request compiles_or_links(const FunctionCall & f, const TC::Compiler &) {
+    const bool links = f.name == "links";
+    const auto & name = extract_keyword_argument<std::shared_ptr<String>>(f.kw_args, "name");
+    return Request{
+        {TC::Check{links ? TC::CheckMode::LINK : TC::CheckMode::COMPILE, get_code(f),
+                   get_args(f)}},
+        [links, name = name ? name.value()->value : ""](const auto & r) {
+            if (!name.empty()) {
+                std::cout << "Checking if \"" << name << "\" " << (links ? "links" : "compiles")
+                          << ": " << yes_no(r[0].success) << std::endl;
+            }
+            return std::make_shared<Boolean>(r[0].success);
+        }};
+}
+
+Request has_function(const FunctionCall & f, const TC::Compiler &) {
+    const auto & func = get_string(f, f.name);
+    const auto & prefix = get_prefix(f);
+    const std::string stub = "#if defined __stub_" + func + " || defined __stub___" + func +
+                             "\nfail fail fail this function is not going to work\n#endif\n";
+
+    std::string code;
+    if (prefix.empty()) {
+        // Declare the function ourselves, making sure that a macro of the same
+        // name from limits.h doesn't get in the way
+        code = "#define " + func + " meson_disable_define_of_" + func + "\n" +
+               "#include <limits.h>\n" + "#undef " + func + "\n" + "#ifdef __cplusplus\n" +
+               "extern \"C\"\n" + "#endif\n" + "char " + func + " (void);\n" + stub +
+               "int main(void) { return " + func + " (); }\n";
+    } else {
+        // The prefix declares the function, so just take it's address
+        code = prefix + "#include <limits.h>\n" + stub + "int main(void) {\n" +
+               "    void * a = (void *) &" + func + ";\n" + "    long long b = (long long) a;\n" +
+               "    return (int) b;\n" + "}\n";
+    }
+
+    return Request{{TC::Check{TC::CheckMode::LINK, code, get_args(f)}}, [func](const auto & r) {
+                       std::cout << "Checking for function \"" << func
+                                 << "\" : " << yes_no(r[0].success) << std::endl;
+                       return std::make_shared<Boolean>(r[0].success);
+                   }};
+}
+
+Request has_arguments(const FunctionCall & f, const TC::Compiler & comp) {
+    const auto & strs =
+        extract_variadic_arguments<std::shared_ptr<String>>(f.pos_args.begin(), f.pos_args.end());
+    if (strs.empty()) {
+        throw Util::Exceptions::InvalidArguments("compiler." + f.name +
+                                                 "(): requires at least one argument");
+    }
+    if (f.name == "has_argument" && strs.size() != 1) {
+        throw Util::Exceptions::InvalidArguments(
+            "compiler.has_argument(): takes exactly one argument");
+    }
+
+    std::vector<std::string> args{};
+    std::string pretty{};
+    for (const auto & s : strs) {
+        const auto & a = comp.check_argument(s->value);
+        args.insert(args.end(), a.begin(), a.end());
+        pretty += (pretty.empty() ? "" : " ") + s->value;
+    }
+
+    return Request{{TC::Check{TC::CheckMode::COMPILE, "int i;\n", args}},
+                   [pretty, lang = comp.language()](const auto & r) {
+                       std::cout << "Compiler for " << lang << " supports arguments " << pretty
+                                 << ": " << yes_no(r[0].success) << std::endl;
+                       return std::make_shared<Boolean>(r[0].success);
+                   }};
+}
+
+Request get_supported_arguments(const FunctionCall & f, const TC::Compiler & comp) {
+    std::vector<std::string> candidates{};
+    for (const auto & s : extract_variadic_arguments<std::shared_ptr<String>>(f.pos_args.begin(),
+                                                                              f.pos_args.end())) {
+        candidates.emplace_back(s->value);
+    }
+
+    Request req{};
+    req.batch = true;
+    for (const auto & c : candidates) {
+        req.checks.emplace_back(
+            TC::Check{TC::CheckMode::COMPILE, "int i;\n", comp.check_argument(c)});
+    }
+    req.result = [candidates, lang = comp.language()](const auto & r) {
+        std::vector<Object> supported{};
+        for (std::size_t i = 0; i < candidates.size(); ++i) {
+            std::cout << "Compiler for " << lang << " supports arguments " << candidates[i]
+                      << ": " << yes_no(r[i].success) << std::endl;
+            if (r[i].success) {
+                supported.emplace_back(std::make_shared<String>(candidates[i]));
+            }
+        }
+        return std::make_shared<Array>(std::move(supported));
+    };
+    return req;
+}
+
+/// Builtin types that compilers predefine a size macro for
+const std::unordered_map<std::string, std::string> SIZEOF_MACROS{
+    {"short", "__SIZEOF_SHORT__"},
+    {"int", "__SIZEOF_INT__"},
+    {"long", "__SIZEOF_LONG__"},
+    {"long long", "__SIZEOF_LONG_LONG__"},
+    {"float", "__SIZEOF_FLOAT__"},
+    {"double", "__SIZEOF_DOUBLE__"},
+    {"long double", "__SIZEOF_LONG_DOUBLE__"},
+    {"size_t", "__SIZEOF_SIZE_T__"},
+    {"ptrdiff_t", "__SIZEOF_PTRDIFF_T__"},
+    {"wchar_t", "__SIZEOF_WCHAR_T__"},
+    {"wint_t", "__SIZEOF_WINT_T__"},
+    {"void *", "__SIZEOF_POINTER__"},
+    {"void*", "__SIZEOF_POINTER__"},
+    {"__int128", "__SIZEOF_INT128__"},
+};
+
+/// Get the size of a type from the compiler's predefined macros, if it has one
+std::optional<int64_t> predefined_size(std::string type, const TC::Compiler & comp) {
+    // Signedness doesn't change the size
+    for (const std::string p : {"unsigned ", "signed "}) {
+        if (type.compare(0, p.size(), p) == 0) {
+            type = type.substr(p.size());
+        }
+    }
+    const auto & name = SIZEOF_MACROS.find(type);
+    if (name == SIZEOF_MACROS.end()) {
+        return std::nullopt;
+    }
+    const auto & value = comp.macros.find(name->second);
+    if (value == comp.macros.end()) {
+        return std::nullopt;
+    }
+    try {
+        return std::stoll(value->second);
+    } catch (std::exception &) {
+        return std::nullopt;
+    }
+}
+
+Request sizeof_method(const FunctionCall & f, const TC::Compiler & comp) {
+    const auto & type = get_string(f, f.name);
+
+    // The compiler already told us the size of the builtin types, so there's
+    // no need to compile and run anything for them. A prefix or arguments may
+    // change the answer though.
+    if (get_prefix(f).empty() && get_args(f).empty()) {
+        if (const auto & size = predefined_size(type, comp)) {
+            return Request{{}, [type, size = size.value()](const auto &) {
+                               std::cout << "Checking for size of \"" << type
+                                         << "\" : " << size << std::endl;
+                               return std::make_shared<Number>(size);
+                           }};
+        }
+    }
+
+    const std::string code = get_prefix(f) + "#include <stdio.h>\n" +
+                             "int main(void) {\n" + "    printf(\"%ld\\n\", (long)(sizeof(" +
+                             type + ")));\n" + "    return 0;\n" + "}\n";
+    return Request{{TC::Check{TC::CheckMode::RUN, code, get_args(f)}}, [type](const auto & r) {
+                       const int64_t size = get_number(r[0]);
+                       std::cout << "Checking for size of \"" << type << "\" : " << size
+                                 << std::endl;
+                       return std::make_shared<Number>(size);
+                   }};
+}
+
+Request alignment(const FunctionCall & f, const TC::Compiler &) {
+    const auto & type = get_string(f, f.name);
+    const std::string code =
+        get_prefix(f) + "#include <stdio.h>\n" + "#include <stddef.h>\n" +
+        "struct meson_align_check {\n" + "    char c;\n" + "    " + type + " target;\n" + "};\n" +
+        "int main(void) {\n" +
+        "    printf(\"%d\\n\", (int)offsetof(struct meson_align_check, target));\n" +
+        "    return 0;\n" + "}\n";
+    return Request{{TC::Check{TC::CheckMode::RUN, code, get_args(f)}}, [type](const auto & r) {
+                       const int64_t align = get_number(r[0]);
+                       if (align < 1) {
+                           throw Util::Exceptions::MesonException(
+                               "Could not determine alignment of \"" + type + "\"");
+                       }
+                       std::cout << "Checking for alignment of \"" << type << "\" : " << align
+                                 << std::endl;
+                       return std::make_shared<Number>(align);
+                   }};
+}
+
+using RequestBuilder = Request (*)(const FunctionCall &, const TC::Compiler &);
+
+const std::unordered_map<std::string, RequestBuilder> METHODS{
+    {"has_header", has_header},
+    {"compiles", compiles_or_links},
+    {"links", compiles_or_links},
+    {"has_function", has_function},
+    {"has_argument", has_arguments},
+    {"has_multi_arguments", has_arguments},
+    {"get_supported_arguments", get_supported_arguments},
+    {"sizeof", sizeof_method},
+    {"alignment", alignment},
+};
+
+/// Set the variable of whichever object the result is
+void set_var(Object & obj, const Variable & var) {
+    std::visit(
+        [&](auto & o) {
+            using T = std::decay_t<decltype(o)>;
+            if constexpr (std::is_same_v<T, std::shared_ptr<Boolean>> ||
+                          std::is_same_v<T, std::shared_ptr<Number>> ||
+                          std::is_same_v<T, std::shared_ptr<Array>>) {
+                o->var = var;
+            }
+        },
+        obj);
+}
+
+std::optional<Object> lower_check(const Object & obj, CompilerChecker & checker,
+                                  LookupMode mode) {
+    if (!std::holds_alternative<std::shared_ptr<FunctionCall>>(obj)) {
+        return std::nullopt;
+    }
+    const auto & f = *std::get<std::shared_ptr<FunctionCall>>(obj);
+
+    if (!(f.holder.has_value() &&
+          std::holds_alternative<std::shared_ptr<Compiler>>(f.holder.value()))) {
+        return std::nullopt;
+    }
+    const auto & method = METHODS.find(f.name);
+    if (method == METHODS.end()) {
+        return std::nullopt;
+    }
+    if (!all_args_reduced(f.pos_args, f.kw_args)) {
+        return std::nullopt;
+    }
+
+    const auto & toolchain = std::get<std::shared_ptr<Compiler>>(f.holder.value())->toolchain;
+    const auto & req = method->second(f, *toolchain->compiler);
+
+    // Start everything before waiting on anything
+    if (req.batch) {
+        checker.start(toolchain, req.checks);
+    } else {
+        for (const auto & c : req.checks) {
+            checker.start(toolchain, c);
+        }
+    }
+
+    std::vector<TC::CheckResult> results{};
+    for (const auto & c : req.checks) {
+        const auto & r = checker.get(*toolchain, c, mode != LookupMode::POLL);
+        if (!r) {
+            return std::nullopt;
+        }
+        results.emplace_back(r.value());
+    }
+
+    // A failed check may be an error, but this call may be in a block that
+    // will be pruned later, so only error once there is nothing left to lower
+    Object ret;
+    try {
+        ret = req.result(results);
+    } catch (const Util::Exceptions::MesonException &) {
+        if (mode != LookupMode::FINAL) {
+            return std::nullopt;
+        }
+        throw;
+    }
+    set_var(ret, f.var);
+    return ret;
+}
+
+} // namespace
+
+CompilerChecker::CompilerChecker(const fs::path & cache_dir)
+    : cache{std::make_shared<const TC::CheckCache>(cache_dir)} {}
+
+void CompilerChecker::start(const std::shared_ptr<Toolchain::Toolchain> & toolchain,
+                            const TC::Check & check) {
+    auto key = TC::check_key(*toolchain->compiler, toolchain->linker.get(), check);
+    if (checks.count(key)) {
+        return;
+    }
+
+    auto result = Util::pool().submit([c = cache, toolchain, check, key]() {
+        const bool cacheable = TC::cacheable(check);
+        if (auto cached = cacheable ? c->get(key) : std::nullopt) {
+            return std::vector<TC::CheckResult>{cached.value()};
+        }
+        const auto & r = TC::run_check(*toolchain->compiler, toolchain->linker.get(), check);
+        if (cacheable) {
+            c->put(key, r);
+        }
+        return std::vector<TC::CheckResult>{r};
+    });
+    checks.emplace(std::move(key), Pending{result.share(), 0});
+}
+
+void CompilerChecker::start(const std::shared_ptr<Toolchain::Toolchain> & toolchain,
+                            const std::vector<TC::Check> & group) {
+    std::vector<TC::Check> todo{};
+    std::vector<std::string> keys{};
+    for (const auto & check : group) {
+        auto key = TC::check_key(*toolchain->compiler, toolchain->linker.get(), check);
+        if (checks.count(key) || std::find(keys.begin(), keys.end(), key) != keys.end()) {
+            continue;
+        }
+        todo.emplace_back(check);
+        keys.emplace_back(std::move(key));
+    }
+    if (todo.empty()) {
+        return;
+    }
+
+    const std::shared_future<std::vector<TC::CheckResult>> results =
+        Util::pool().submit([c = cache, toolchain, todo, keys]() {
+            std::vector<TC::CheckResult> results(todo.size(), TC::CheckResult{false, ""});
+
+            // Only run the checks that aren't already cached
+            std::vector<TC::Check> missing{};
+            std::vector<std::size_t> indexes{};
+            for (std::size_t i = 0; i < todo.size(); ++i) {
+                if (auto cached = TC::cacheable(todo[i]) ? c->get(keys[i]) : std::nullopt) {
+                    results[i] = cached.value();
+                } else {
+                    missing.emplace_back(todo[i]);
+                    indexes.emplace_back(i);
+                }
+            }
+
+            const auto & ran = TC::run_argument_checks(*toolchain->compiler, missing);
+            for (std::size_t i = 0; i < ran.size(); ++i) {
+                results[indexes[i]] = ran[i];
+                if (TC::cacheable(missing[i])) {
+                    c->put(keys[indexes[i]], ran[i]);
+                }
+            }
+            return results;
+        }).share();
+
+    // Every check in the group shares the one job, and picks it's own result
+    // out of it
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        checks.emplace(std::move(keys[i]), Pending{results, i});
+    }
+}
+
+std::optional<TC::CheckResult> CompilerChecker::get(const Toolchain::Toolchain & toolchain,
+                                                    const TC::Check & check, bool wait) {
+    const auto & pending =
+        checks.at(TC::check_key(*toolchain.compiler, toolchain.linker.get(), check));
+    if (wait) {
+        Util::pool().wait(pending.results);
+    } else if (pending.results.wait_for(std::chrono::seconds{0}) != std::future_status::ready) {
+        return std::nullopt;
+    }
+    return pending.results.get()[pending.index];
+}
+
+bool compiler_checks(BasicBlock * block, CompilerChecker & checker, LookupMode mode) {
+    return function_walker(
+        block, [&](const Object & obj) { return lower_check(obj, checker, mode); });
+}
+
+} // namespace MIR::Passes
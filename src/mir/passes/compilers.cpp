@@ -64,7 +64,9 @@ std::optional<Object> replace_compiler(const Object & obj, const ToolchainMap &
     }
 
     try {
-        return std::make_unique<Compiler>(tc.at(lang).get(m));
+        auto comp = std::make_shared<Compiler>(tc.at(lang).get(m));
+        comp->var = f->var;
+        return comp;
     } catch (std::out_of_range &) {
         // TODO: add a better error message
         throw Util::Exceptions::MesonException{"No compiler for language"};
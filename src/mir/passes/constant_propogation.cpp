@@ -2,6 +2,7 @@
 // Copyright © 2021 Dylan Baker
 
 #include <cassert>
+#include <type_traits>
 
 #include "exceptions.hpp"
 #include "passes.hpp"
@@ -24,6 +25,60 @@ bool identifier_to_object_mapper(Object & obj, PropTable & table) {
     return false;
 }
 
+/**
+ * Copy a container for a new use
+ *
+ * Blocks are lowered in parallel, so each use needs it's own container,
+ * otherwise lowering the elements in one block would race with lowering them in
+ * another. Function calls are rewritten in place by lowering, so a container
+ * holding one isn't propagated until the defining block has lowered it. The
+ * other elements are immutable, and can be shared.
+ */
+std::optional<Object> copy_element(const Object & obj) {
+    if (std::holds_alternative<std::shared_ptr<Array>>(obj)) {
+        const auto & arr = *std::get<std::shared_ptr<Array>>(obj);
+        std::vector<Object> value{};
+        for (const auto & e : arr.value) {
+            auto c = copy_element(e);
+            if (!c) {
+                return std::nullopt;
+            }
+            value.emplace_back(std::move(c.value()));
+        }
+        auto copy = std::make_shared<Array>(std::move(value));
+        copy->var = arr.var;
+        return copy;
+    } else if (std::holds_alternative<std::shared_ptr<Dict>>(obj)) {
+        const auto & dict = *std::get<std::shared_ptr<Dict>>(obj);
+        auto copy = std::make_shared<Dict>();
+        for (const auto & [k, e] : dict.value) {
+            auto c = copy_element(e);
+            if (!c) {
+                return std::nullopt;
+            }
+            copy->value.emplace(k, std::move(c.value()));
+        }
+        copy->var = dict.var;
+        return copy;
+    } else if (std::holds_alternative<std::unique_ptr<Identifier>>(obj)) {
+        const auto & id = *std::get<std::unique_ptr<Identifier>>(obj);
+        return std::make_unique<Identifier>(id.value, id.version, Variable{id.var});
+    } else if (std::holds_alternative<std::shared_ptr<FunctionCall>>(obj)) {
+        return std::nullopt;
+    }
+
+    return std::visit(
+        [](const auto & o) -> std::optional<Object> {
+            using T = std::decay_t<decltype(o)>;
+            if constexpr (std::is_copy_constructible_v<T>) {
+                return o;
+            } else {
+                return std::nullopt;
+            }
+        },
+        obj);
+}
+
 std::optional<Object> get_value(const Identifier & id, const PropTable & table) {
     const Variable var{id.value, id.version};
     if (const auto & val = table.find(var); val != table.end()) {
@@ -34,10 +89,9 @@ std::optional<Object> get_value(const Identifier & id, const PropTable & table)
             return std::get<std::shared_ptr<String>>(v);
         } else if (std::holds_alternative<std::shared_ptr<Boolean>>(v)) {
             return std::get<std::shared_ptr<Boolean>>(v);
-        } else if (std::holds_alternative<std::shared_ptr<Array>>(v)) {
-            return std::get<std::shared_ptr<Array>>(v);
-        } else if (std::holds_alternative<std::shared_ptr<Dict>>(v)) {
-            return std::get<std::shared_ptr<Dict>>(v);
+        } else if (std::holds_alternative<std::shared_ptr<Array>>(v) ||
+                   std::holds_alternative<std::shared_ptr<Dict>>(v)) {
+            return copy_element(v);
         } else if (std::holds_alternative<std::shared_ptr<Compiler>>(v)) {
             return std::get<std::shared_ptr<Compiler>>(v);
         } else if (std::holds_alternative<std::shared_ptr<File>>(v)) {
@@ -90,6 +144,7 @@ bool constant_propogation_holder_impl(Object & obj, const PropTable & table) {
             auto v = get_value(*id, table);
             if (v) {
                 func->holder = std::move(v);
+                progress = true;
             }
         }
     }
@@ -125,6 +180,15 @@ bool constant_propogation(BasicBlock * block, PropTable & table) {
             prop,
         });
 
+    // The condition may use values as well
+    if (std::holds_alternative<std::unique_ptr<Condition>>(block->next)) {
+        auto & con = std::get<std::unique_ptr<Condition>>(block->next);
+        progress |= array_walker(con->condition, prop);
+        progress |= function_argument_walker(con->condition, prop);
+        progress |= function_argument_walker(con->condition, prop_h);
+        progress |= prop_h(con->condition);
+    }
+
     return progress;
 }
 
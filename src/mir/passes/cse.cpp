@@ -0,0 +1,140 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <sstream>
+#include <unordered_map>
+
+#include "passes.hpp"
+#include "private.hpp"
+
+namespace MIR::Passes {
+
+namespace {
+
+/// Builtins which always give the same result for the same arguments
+bool is_cse_candidate(const FunctionCall & f) {
+    return !f.holder.has_value() && (f.name == "files" || f.name == "include_directories" ||
+                                     f.name == "declare_dependency");
+}
+
+/**
+ * Write a structural key for an argument
+ *
+ * Two arguments with the same key are the same value. Objects that have
+ * identity (like targets) are keyed on that identity.
+ *
+ * returns false if the argument cannot be keyed
+ */
+bool write_key(const Object & obj, std::ostream & out) {
+    if (std::holds_alternative<std::shared_ptr<String>>(obj)) {
+        const auto & v = std::get<std::shared_ptr<String>>(obj)->value;
+        out << "s" << v.size() << ':' << v;
+    } else if (std::holds_alternative<std::shared_ptr<Number>>(obj)) {
+        out << "n" << std::get<std::shared_ptr<Number>>(obj)->value << ';';
+    } else if (std::holds_alternative<std::shared_ptr<Boolean>>(obj)) {
+        out << (std::get<std::shared_ptr<Boolean>>(obj)->value ? "t" : "f");
+    } else if (std::holds_alternative<std::shared_ptr<File>>(obj)) {
+        const auto & f = *std::get<std::shared_ptr<File>>(obj);
+        const std::string v = f.relative_to_source_dir();
+        out << (f.is_built() ? "B" : "F") << v.size() << ':' << v;
+    } else if (std::holds_alternative<std::shared_ptr<Array>>(obj)) {
+        const auto & arr = *std::get<std::shared_ptr<Array>>(obj);
+        out << "a" << arr.value.size() << '[';
+        for (const auto & e : arr.value) {
+            if (!write_key(e, out)) {
+                return false;
+            }
+        }
+        out << ']';
+    } else if (std::holds_alternative<std::shared_ptr<IncludeDirectories>>(obj)) {
+        out << "i" << std::get<std::shared_ptr<IncludeDirectories>>(obj).get() << ';';
+    } else if (std::holds_alternative<std::shared_ptr<Dependency>>(obj)) {
+        out << "d" << std::get<std::shared_ptr<Dependency>>(obj).get() << ';';
+    } else if (std::holds_alternative<std::shared_ptr<StaticLibrary>>(obj)) {
+        out << "l" << std::get<std::shared_ptr<StaticLibrary>>(obj).get() << ';';
+    } else if (std::holds_alternative<std::shared_ptr<CustomTarget>>(obj)) {
+        out << "c" << std::get<std::shared_ptr<CustomTarget>>(obj).get() << ';';
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/// Get the structural key of a call, (name, source_dir, arguments)
+std::optional<std::string> call_key(const FunctionCall & f) {
+    std::ostringstream out{};
+    out << f.name << '\0' << f.source_dir.string() << '\0';
+
+    for (const auto & a : f.pos_args) {
+        if (!write_key(a, out)) {
+            return std::nullopt;
+        }
+    }
+
+    // Keyword arguments are unordered, so sort them first
+    std::map<std::string, const Object *> kwargs{};
+    for (const auto & [k, v] : f.kw_args) {
+        kwargs.emplace(k, &v);
+    }
+    for (const auto & [k, v] : kwargs) {
+        out << '\0' << k << '=';
+        if (!write_key(*v, out)) {
+            return std::nullopt;
+        }
+    }
+
+    return out.str();
+}
+
+} // namespace
+
+bool common_subexpression_elimination(BasicBlock * root) {
+    const DominatorTree dom{root};
+
+    // key : (variable, block) of the first call
+    std::unordered_map<std::string, std::tuple<Variable, const BasicBlock *>> seen{};
+    bool progress = false;
+
+    // Reverse post order guarantees that we see a dominating call before any
+    // it dominates
+    for (BasicBlock * block : dom.blocks) {
+        for (auto & obj : block->instructions) {
+            if (!std::holds_alternative<std::shared_ptr<FunctionCall>>(obj)) {
+                continue;
+            }
+            const auto & f = *std::get<std::shared_ptr<FunctionCall>>(obj);
+
+            // We need a variable to point at the first result, and to
+            // replace the duplicate with, and the variable must have been
+            // numbered so we point at the right definition.
+            if (!is_cse_candidate(f) || !f.var || f.var.version == 0 ||
+                !all_args_reduced(f.pos_args, f.kw_args)) {
+                continue;
+            }
+
+            const auto & key = call_key(f);
+            if (!key) {
+                continue;
+            }
+
+            const auto & [it, inserted] = seen.try_emplace(key.value(), f.var, block);
+            if (inserted) {
+                continue;
+            }
+
+            // Only reuse the first result if it is available on every path
+            // to this call
+            const auto & [first, first_block] = it->second;
+            if (!dom.dominates(first_block, block)) {
+                continue;
+            }
+
+            obj = std::make_unique<Identifier>(first.name, first.version, Variable{f.var});
+            progress = true;
+        }
+    }
+
+    return progress;
+}
+
+} // namespace MIR::Passes
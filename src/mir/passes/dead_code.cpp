@@ -1,12 +1,78 @@
 // SPDX-License-Identifier: Apache-2.0
 // Copyright © 2021 Dylan Baker
 
+#include <set>
+
 #include "exceptions.hpp"
 #include "passes.hpp"
 #include "private.hpp"
 
 namespace MIR::Passes {
 
+namespace {
+
+/// The variables that are read somewhere in the program
+struct LiveSet {
+    std::set<Variable> vars;
+
+    /// Names used without a version, which keep every version alive
+    std::set<std::string> names;
+
+    bool is_live(const Variable & var) const {
+        return vars.count(var) || names.count(var.name);
+    }
+};
+
+void collect_uses(const Object & obj, LiveSet & live) {
+    if (std::holds_alternative<std::unique_ptr<Identifier>>(obj)) {
+        const auto & id = *std::get<std::unique_ptr<Identifier>>(obj);
+        if (id.version == 0) {
+            live.names.emplace(id.value);
+        } else {
+            live.vars.emplace(id.value, id.version);
+        }
+    } else if (std::holds_alternative<std::unique_ptr<Phi>>(obj)) {
+        const auto & phi = *std::get<std::unique_ptr<Phi>>(obj);
+        live.vars.emplace(phi.var.name, phi.left);
+        live.vars.emplace(phi.var.name, phi.right);
+    } else if (std::holds_alternative<std::shared_ptr<Array>>(obj)) {
+        for (const auto & e : std::get<std::shared_ptr<Array>>(obj)->value) {
+            collect_uses(e, live);
+        }
+    } else if (std::holds_alternative<std::shared_ptr<Dict>>(obj)) {
+        for (const auto & [_, e] : std::get<std::shared_ptr<Dict>>(obj)->value) {
+            collect_uses(e, live);
+        }
+    } else if (std::holds_alternative<std::shared_ptr<FunctionCall>>(obj)) {
+        const auto & f = *std::get<std::shared_ptr<FunctionCall>>(obj);
+        if (f.holder) {
+            collect_uses(f.holder.value(), live);
+        }
+        for (const auto & e : f.pos_args) {
+            collect_uses(e, live);
+        }
+        for (const auto & [_, e] : f.kw_args) {
+            collect_uses(e, live);
+        }
+    }
+}
+
+/**
+ * Can this object be removed if nothing reads it?
+ *
+ * Targets and messages have side effects even if they are never used, and we
+ * can't know what an unlowered function call will do.
+ */
+bool is_pure(const Object & obj) {
+    return !(std::holds_alternative<std::shared_ptr<FunctionCall>>(obj) ||
+             std::holds_alternative<std::shared_ptr<Executable>>(obj) ||
+             std::holds_alternative<std::shared_ptr<StaticLibrary>>(obj) ||
+             std::holds_alternative<std::shared_ptr<CustomTarget>>(obj) ||
+             std::holds_alternative<std::unique_ptr<Message>>(obj));
+}
+
+} // namespace
+
 bool delete_unreachable(BasicBlock & block) {
     // If we see an Message object that is an error, that block will not return,
     // break it's next connection
@@ -14,6 +80,12 @@ bool delete_unreachable(BasicBlock & block) {
         if (std::holds_alternative<std::unique_ptr<Message>>(*itr)) {
             const auto & m = *std::get<std::unique_ptr<Message>>(*itr);
             if (m.level == MessageLevel::ERROR) {
+                // If this has already been done there's nothing to do
+                if (std::holds_alternative<std::monostate>(block.next) &&
+                    std::next(itr) == block.instructions.end()) {
+                    return false;
+                }
+
                 // Delete any children point to this block
                 if (std::holds_alternative<std::shared_ptr<BasicBlock>>(block.next)) {
                     auto & b = *std::get<std::shared_ptr<BasicBlock>>(block.next);
@@ -39,4 +111,43 @@ bool delete_unreachable(BasicBlock & block) {
     return false;
 }
 
+bool delete_dead_values(BasicBlock * block) {
+    const std::vector<BasicBlock *> blocks = DominatorTree{block}.blocks;
+
+    bool progress = false;
+    bool lprogress;
+
+    // Removing a value can make the values it read dead, so keep going until
+    // nothing else can be removed.
+    do {
+        lprogress = false;
+
+        LiveSet live{};
+        for (const auto * b : blocks) {
+            for (const auto & i : b->instructions) {
+                collect_uses(i, live);
+            }
+            if (std::holds_alternative<std::unique_ptr<Condition>>(b->next)) {
+                collect_uses(std::get<std::unique_ptr<Condition>>(b->next)->condition, live);
+            }
+        }
+
+        for (auto * b : blocks) {
+            for (auto it = b->instructions.begin(); it != b->instructions.end();) {
+                const auto & var = std::visit([](const auto & o) { return o->var; }, *it);
+                if (is_pure(*it) && !(var && live.is_live(var))) {
+                    it = b->instructions.erase(it);
+                    lprogress = true;
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        progress |= lprogress;
+    } while (lprogress);
+
+    return progress;
+}
+
 } // namespace MIR::Passes
@@ -80,7 +80,7 @@ std::optional<Object> lower_dependency_methods_impl(const Object & obj,
 
 } // namespace
 
-bool lower_dependency_objects(BasicBlock & block, State::Persistant & pstate) {
+bool lower_dependency_objects(BasicBlock & block, const State::Persistant & pstate) {
     return function_walker(
         &block, [&](const Object & obj) { return lower_dependency_methods_impl(obj, pstate); });
 }
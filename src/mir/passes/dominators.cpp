@@ -0,0 +1,176 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <tuple>
+#include <unordered_map>
+
+#include "private.hpp"
+
+namespace MIR::Passes {
+
+namespace {
+
+/// Get the successors of a block, true branch first
+std::vector<BasicBlock *> successors(const BasicBlock * block) {
+    std::vector<BasicBlock *> succs{};
+    if (std::holds_alternative<std::unique_ptr<Condition>>(block->next)) {
+        const auto & con = std::get<std::unique_ptr<Condition>>(block->next);
+        if (con->if_true != nullptr) {
+            succs.emplace_back(con->if_true.get());
+        }
+        if (con->if_false != nullptr) {
+            succs.emplace_back(con->if_false.get());
+        }
+    } else if (std::holds_alternative<std::shared_ptr<BasicBlock>>(block->next)) {
+        const auto & bb = std::get<std::shared_ptr<BasicBlock>>(block->next);
+        if (bb != nullptr) {
+            succs.emplace_back(bb.get());
+        }
+    }
+    return succs;
+}
+
+} // namespace
+
+DominatorTree::DominatorTree(BasicBlock * root) {
+    // Calculate a post order with an explicit stack, so that very long
+    // condition chains don't blow the stack
+    std::vector<BasicBlock *> post{};
+    {
+        std::vector<std::tuple<BasicBlock *, std::vector<BasicBlock *>, std::size_t>> stack{};
+        positions[root] = 0;
+        stack.emplace_back(root, successors(root), 0);
+        while (!stack.empty()) {
+            auto & [block, succs, i] = stack.back();
+            if (i < succs.size()) {
+                BasicBlock * s = succs[i++];
+                if (positions.emplace(s, 0).second) {
+                    stack.emplace_back(s, successors(s), 0);
+                }
+            } else {
+                post.emplace_back(block);
+                stack.pop_back();
+            }
+        }
+    }
+
+    blocks.assign(post.rbegin(), post.rend());
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        positions[blocks[i]] = i;
+    }
+
+    // The parents of a block are not always precise (elif branches don't
+    // record theirs), so calculate the predecessors from the edges themselves,
+    // sorted the same way parents are.
+    preds.resize(blocks.size());
+    for (BasicBlock * b : blocks) {
+        for (BasicBlock * s : successors(b)) {
+            preds[positions.at(s)].emplace_back(b);
+        }
+    }
+    for (auto & p : preds) {
+        std::sort(p.begin(), p.end(), BBComparitor{});
+        p.erase(std::unique(p.begin(), p.end()), p.end());
+    }
+
+    // Cooper, Harvey, Kennedy. Because everything is in reverse post order,
+    // dominators always have a lower position than the blocks they dominate,
+    // and walking up the tree is just walking to lower positions
+    static constexpr std::size_t UNDEFINED = std::numeric_limits<std::size_t>::max();
+    idoms.assign(blocks.size(), UNDEFINED);
+    idoms[0] = 0;
+
+    const auto intersect = [&](std::size_t b1, std::size_t b2) {
+        while (b1 != b2) {
+            while (b1 > b2) {
+                b1 = idoms[b1];
+            }
+            while (b2 > b1) {
+                b2 = idoms[b2];
+            }
+        }
+        return b1;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (std::size_t i = 1; i < blocks.size(); ++i) {
+            std::size_t new_idom = UNDEFINED;
+            for (const auto & p : preds[i]) {
+                const std::size_t pos = positions.at(p);
+                if (idoms[pos] == UNDEFINED) {
+                    continue;
+                }
+                new_idom = new_idom == UNDEFINED ? pos : intersect(pos, new_idom);
+            }
+            if (idoms[i] != new_idom) {
+                idoms[i] = new_idom;
+                changed = true;
+            }
+        }
+    }
+
+    dom_children.resize(blocks.size());
+    for (std::size_t i = 1; i < blocks.size(); ++i) {
+        assert(idoms[i] != UNDEFINED);
+        dom_children[idoms[i]].emplace_back(blocks[i]);
+    }
+
+    // Every join point is in the frontier of each of the blocks between it's
+    // parents and it's immediate dominator
+    frontiers.resize(blocks.size());
+    for (std::size_t i = 1; i < blocks.size(); ++i) {
+        if (preds[i].size() < 2) {
+            continue;
+        }
+        for (const auto & p : preds[i]) {
+            std::size_t runner = positions.at(p);
+            while (runner != idoms[i]) {
+                auto & f = frontiers[runner];
+                if (f.empty() || f.back() != blocks[i]) {
+                    f.emplace_back(blocks[i]);
+                }
+                runner = idoms[runner];
+            }
+        }
+    }
+}
+
+std::size_t DominatorTree::position(const BasicBlock * block) const {
+    return positions.at(block);
+}
+
+bool DominatorTree::contains(const BasicBlock * block) const {
+    return positions.find(block) != positions.end();
+}
+
+BasicBlock * DominatorTree::idom(const BasicBlock * block) const {
+    return blocks[idoms[position(block)]];
+}
+
+const std::vector<BasicBlock *> & DominatorTree::predecessors(const BasicBlock * block) const {
+    return preds[position(block)];
+}
+
+const std::vector<BasicBlock *> & DominatorTree::children(const BasicBlock * block) const {
+    return dom_children[position(block)];
+}
+
+const std::vector<BasicBlock *> & DominatorTree::frontier(const BasicBlock * block) const {
+    return frontiers[position(block)];
+}
+
+bool DominatorTree::dominates(const BasicBlock * a, const BasicBlock * b) const {
+    const std::size_t pa = position(a);
+    std::size_t pb = position(b);
+    while (pb > pa) {
+        pb = idoms[pb];
+    }
+    return pa == pb;
+}
+
+} // namespace MIR::Passes
@@ -0,0 +1,170 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "argument_extractors.hpp"
+#include "exceptions.hpp"
+#include "log.hpp"
+#include "passes.hpp"
+#include "private.hpp"
+#include "thread_pool.hpp"
+
+namespace MIR::Passes {
+
+namespace {
+
+std::string lookup_key(const std::string & name, bool static_) {
+    return name + '\0' + (static_ ? "static" : "shared");
+}
+
+/// Convert pkg-config flags into generic arguments
+std::vector<Arguments::Argument> generalize(const std::vector<std::string> & flags,
+                                            const State::Persistant & pstate) {
+    // XXX: this assumes C++
+    const auto & comp_at = pstate.toolchains.find(Toolchain::Language::CPP);
+    if (comp_at == pstate.toolchains.end()) {
+        throw Util::Exceptions::MesonException(
+            "Tried to use a dependency without a C++ toolchain.");
+    }
+    const auto & comp = comp_at->second.build()->compiler;
+
+    std::vector<Arguments::Argument> args{};
+    for (const auto & f : flags) {
+        args.emplace_back(comp->generalize_argument(f));
+    }
+    return args;
+}
+
+std::optional<Object> lower_dependency(const Object & obj, const State::Persistant & pstate,
+                                       DependencyFinder & finder, LookupMode mode) {
+    if (!std::holds_alternative<std::shared_ptr<FunctionCall>>(obj)) {
+        return std::nullopt;
+    }
+    const auto & f = *std::get<std::shared_ptr<FunctionCall>>(obj);
+    if (f.holder.has_value() || f.name != "dependency") {
+        return std::nullopt;
+    }
+    if (!all_args_reduced(f.pos_args, f.kw_args)) {
+        return std::nullopt;
+    }
+
+    if (f.pos_args.size() != 1) {
+        throw Util::Exceptions::InvalidArguments(
+            "dependency(): takes exactly one positional argument");
+    }
+    const auto & name_arg = extract_positional_argument<std::shared_ptr<String>>(f.pos_args[0]);
+    if (!name_arg) {
+        throw Util::Exceptions::InvalidArguments("dependency(): first argument must be a string");
+    }
+    const std::string & name = name_arg.value()->value;
+
+    const auto & method = extract_keyword_argument<std::shared_ptr<String>>(f.kw_args, "method");
+    if (method && method.value()->value != "auto" && method.value()->value != "pkg-config") {
+        throw Util::Exceptions::InvalidArguments("dependency(): method \"" +
+                                                 method.value()->value + "\" is not supported");
+    }
+
+    const bool static_ = extract_keyword_argument<std::shared_ptr<Boolean>>(f.kw_args, "static")
+                             .value_or(std::make_shared<Boolean>(false))
+                             ->value;
+    const bool required =
+        extract_keyword_argument<std::shared_ptr<Boolean>>(f.kw_args, "required")
+            .value_or(std::make_shared<Boolean>(true))
+            ->value;
+
+    std::vector<PkgConfig::Constraint> constraints{};
+    std::string pretty_constraints{};
+    const auto & versions =
+        extract_keyword_argument_a<std::shared_ptr<String>>(f.kw_args, "version");
+    for (const auto & v : versions) {
+        constraints.emplace_back(PkgConfig::parse_constraint(v->value));
+        pretty_constraints += (pretty_constraints.empty() ? "" : " ") + v->value;
+    }
+
+    finder.start(name, static_);
+    const auto & result = finder.get(name, static_, mode != LookupMode::POLL);
+    if (!result) {
+        return std::nullopt;
+    }
+    const auto & pkg = result->package;
+
+    const bool version_ok =
+        pkg != nullptr &&
+        std::all_of(constraints.begin(), constraints.end(), [&](const PkgConfig::Constraint & c) {
+            return Version::compare(pkg->version, c.op, c.version);
+        });
+
+    if (pkg == nullptr || !version_ok) {
+        // This call may be in a block that will be pruned later, so only
+        // error once there is nothing left to lower
+        if (required && mode != LookupMode::FINAL) {
+            return std::nullopt;
+        }
+        std::cout << "Run-time dependency " << name << " found: " << Util::Log::red("NO");
+        if (pkg != nullptr) {
+            std::cout << " found " << pkg->version << " but need: " << pretty_constraints;
+        } else if (!result->error.empty()) {
+            std::cout << " (" << result->error << ")";
+        }
+        std::cout << std::endl;
+        if (required) {
+            throw Util::Exceptions::MesonException(
+                "Dependency \"" + name + "\" not found" +
+                (result->error.empty() ? "" : ": " + result->error));
+        }
+        return std::make_shared<Dependency>(name, false, "", std::vector<Arguments::Argument>{},
+                                            std::vector<Arguments::Argument>{},
+                                            DependencyType::PKGCONFIG, f.var);
+    }
+
+    std::cout << "Run-time dependency " << name << " found: " << Util::Log::green("YES") << " "
+              << pkg->version << std::endl;
+    return std::make_shared<Dependency>(name, true, pkg->version, generalize(pkg->cflags, pstate),
+                                        generalize(pkg->libs, pstate), DependencyType::PKGCONFIG,
+                                        f.var);
+}
+
+} // namespace
+
+DependencyFinder::DependencyFinder(const std::vector<fs::path> & search_path)
+    : resolver{std::make_shared<const PkgConfig::Resolver>(search_path)} {}
+
+void DependencyFinder::start(const std::string & name, bool static_) {
+    auto key = lookup_key(name, static_);
+    if (lookups.count(key)) {
+        return;
+    }
+    auto result = Util::pool().submit([r = resolver, name, static_]() -> Result {
+        try {
+            if (auto pkg = r->find(name, {}, static_)) {
+                return {std::make_shared<const PkgConfig::Package>(std::move(pkg.value())), ""};
+            }
+        } catch (const Util::Exceptions::MesonException & e) {
+            return {nullptr, e.what()};
+        }
+        return {nullptr, ""};
+    });
+    lookups.emplace(std::move(key), result.share());
+}
+
+std::optional<DependencyFinder::Result> DependencyFinder::get(const std::string & name,
+                                                              bool static_, bool wait) {
+    const auto & result = lookups.at(lookup_key(name, static_));
+    if (wait) {
+        Util::pool().wait(result);
+    } else if (result.wait_for(std::chrono::seconds{0}) != std::future_status::ready) {
+        return std::nullopt;
+    }
+    return result.get();
+}
+
+bool find_dependencies(BasicBlock * block, const State::Persistant & pstate,
+                       DependencyFinder & finder, LookupMode mode) {
+    return function_walker(
+        block, [&](const Object & obj) { return lower_dependency(obj, pstate, finder, mode); });
+}
+
+} // namespace MIR::Passes
@@ -45,7 +45,10 @@ std::optional<Object> flatten_cb(const Object & obj) {
     std::vector<Object> newarr{};
     do_flatten(arr, newarr);
 
-    return std::make_shared<Array>(std::move(newarr));
+    // The array may be an assignment, which must still define the same variable
+    auto flat = std::make_shared<Array>(std::move(newarr));
+    flat->var = arr->var;
+    return flat;
 }
 
 } // namespace
@@ -9,6 +9,7 @@
 #include "log.hpp"
 #include "passes.hpp"
 #include "private.hpp"
+#include "thread_pool.hpp"
 
 namespace MIR::Passes {
 
@@ -120,17 +121,21 @@ std::optional<std::shared_ptr<T>> lower_build_target(const FunctionCall & f,
         }
     }
 
+    std::vector<Arguments::Argument> link_args{};
     const auto & deps =
         extract_keyword_argument_a<std::shared_ptr<Dependency>>(f.kw_args, "dependencies");
     for (const auto & d : deps) {
         for (const auto & a : d->arguments) {
             args[Toolchain::Language::CPP].emplace_back(a);
         }
+        for (const auto & a : d->link_arguments) {
+            link_args.emplace_back(a);
+        }
     }
 
     // TODO: machine parameter needs to be set from the native kwarg
     return std::make_shared<T>(name.value()->value, srcs, Machines::Machine::BUILD, f.source_dir,
-                               args, slink, f.var);
+                               args, slink, link_args, f.var);
 }
 
 std::optional<Object> lower_include_dirs(const FunctionCall & f, const State::Persistant & pstate) {
@@ -201,28 +206,30 @@ std::optional<Object> lower_assert(const FunctionCall & f) {
     return std::make_unique<Empty>();
 }
 
-std::optional<Object> lower_not(const FunctionCall & f) {
+std::optional<Object> lower_neg(const FunctionCall & f) {
     // TODO: is this code actually reachable?
     if (f.pos_args.size() != 1) {
-        throw Util::Exceptions::InvalidArguments("not: takes 1 argument, got " +
+        throw Util::Exceptions::InvalidArguments("neg: takes 1 argument, got " +
                                                  std::to_string(f.pos_args.size()));
     }
 
-    const auto & value = extract_positional_argument<std::shared_ptr<Boolean>>(f.pos_args[0]);
+    const auto & value = extract_positional_argument<std::shared_ptr<Number>>(f.pos_args[0]);
 
-    return std::make_shared<Boolean>(!value.value()->value);
+    return std::make_shared<Number>(-value.value()->value);
 }
 
-std::optional<Object> lower_neg(const FunctionCall & f) {
+} // namespace
+
+std::optional<Object> lower_not(const FunctionCall & f) {
     // TODO: is this code actually reachable?
     if (f.pos_args.size() != 1) {
-        throw Util::Exceptions::InvalidArguments("neg: takes 1 argument, got " +
+        throw Util::Exceptions::InvalidArguments("not: takes 1 argument, got " +
                                                  std::to_string(f.pos_args.size()));
     }
 
-    const auto & value = extract_positional_argument<std::shared_ptr<Number>>(f.pos_args[0]);
+    const auto & value = extract_positional_argument<std::shared_ptr<Boolean>>(f.pos_args[0]);
 
-    return std::make_shared<Number>(-value.value()->value);
+    return std::make_shared<Boolean>(!value.value()->value);
 }
 
 std::optional<Object> lower_eq(const FunctionCall & f) {
@@ -301,6 +308,8 @@ std::optional<Object> lower_ne(const FunctionCall & f) {
     return std::make_shared<Boolean>(value, f.var);
 }
 
+namespace {
+
 std::optional<Object> lower_declare_dependency(const FunctionCall & f,
                                                const State::Persistant & pstate) {
     if (!f.pos_args.empty()) {
@@ -353,13 +362,18 @@ std::optional<Object> lower_declare_dependency(const FunctionCall & f,
 
     const auto & raw_deps =
         extract_keyword_argument_a<std::shared_ptr<Dependency>>(f.kw_args, "dependencies");
+    std::vector<Arguments::Argument> link_args{};
     for (const auto & d : raw_deps) {
         for (const auto & a : d->arguments) {
             args.emplace_back(a);
         }
+        for (const auto & a : d->link_arguments) {
+            link_args.emplace_back(a);
+        }
     }
 
-    return std::make_shared<Dependency>("internal", true, version, args, f.var);
+    return std::make_shared<Dependency>("internal", true, version, args, link_args,
+                                        DependencyType::INTERNAL, f.var);
 }
 
 Source extract_source(const Object & obj, const fs::path & current_source_dir,
@@ -628,17 +642,33 @@ void lower_project(BasicBlock * block, State::Persistant & pstate) {
     std::cout << "Project name: " << Util::Log::bold(pstate.name) << std::endl;
 
     const auto & langs = extract_variadic_arguments<std::shared_ptr<String>>(pos, f.pos_args.end());
+
+    // Detect every language's toolchain at once, detection may also have been
+    // started already, while parsing. Report them in the order they were given.
+    for (const auto & lang : langs) {
+        pstate.detect_toolchain(Toolchain::from_string(lang->value));
+    }
+
     for (const auto & lang : langs) {
         const auto l = Toolchain::from_string(lang->value);
+        auto detected = pstate.detecting.find(l);
+        if (detected == pstate.detecting.end()) {
+            // A language listed twice
+            continue;
+        }
+        Util::pool().wait(detected->second);
 
         auto & tc = pstate.toolchains[l];
-
         // TODO: need to do host as well, when that is relavent
-        tc.set(Machines::Machine::BUILD,
-               std::make_shared<Toolchain::Toolchain>(
-                   Toolchain::get_toolchain(l, Machines::Machine::BUILD)));
+        tc.set(Machines::Machine::BUILD, detected->second.get());
+        pstate.detecting.erase(detected);
         const auto & c = tc.build()->compiler;
 
+        // The compiler knows the machine it's targeting better than we do
+        if (auto info = Machines::from_macros(Machines::Machine::BUILD, c->macros)) {
+            pstate.machines.set(Machines::Machine::BUILD, std::move(info.value()));
+        }
+
         // TODO: print the print the full version
         std::cout << c->language()
                   << " compiler for the for build machine: " << Util::Log::bold(c->id()) << " ("
@@ -1,6 +1,9 @@
 // SPDX-license-identifier: Apache-2.0
 // Copyright © 2021 Dylan Baker
 
+#include <map>
+#include <set>
+
 #include "passes.hpp"
 #include "private.hpp"
 
@@ -8,120 +11,178 @@ namespace MIR::Passes {
 
 namespace {
 
-/// Does this block have only one parent?
-inline bool is_strictly_dominated(const BasicBlock * block) { return block->parents.size() == 1; }
-
 /// Get a variable from an Object
 inline auto get_variable = [](const auto & obj) { return obj->var; };
 
-/// Allows comparing Phi pointers, using the value comparisons
-struct PhiComparator {
-    bool operator()(const Phi * l, const Phi * r) const { return *l < *r; };
-};
-
-template <typename T> struct reversion_wrapper { T & iterable; };
-
-template <typename T> auto begin(reversion_wrapper<T> w) { return std::rbegin(w.iterable); }
-
-template <typename T> auto end(reversion_wrapper<T> w) { return std::rend(w.iterable); }
-
-template <typename T> reversion_wrapper<T> reverse(T && iterable) { return {iterable}; }
+/// The last version of each variable defined in a block
+using DefinitionTable = std::unordered_map<std::string, uint32_t>;
+
+/**
+ * Find the version of a variable that reaches the end of a block
+ *
+ * If the block doesn't define the variable itself, then the definition
+ * reaching it is the one reaching the end of it's immediate dominator. Since
+ * phis have been inserted on the iterated dominance frontier, and we process
+ * blocks in reverse post order, this is guaranteed to be correct.
+ *
+ * returns 0 if the variable is not defined on this path
+ */
+uint32_t reaching_definition(const BasicBlock * block, const std::string & name,
+                             const DominatorTree & dom,
+                             const std::vector<DefinitionTable> & defs) {
+    std::size_t pos = dom.position(block);
+    while (true) {
+        const auto & table = defs[pos];
+        if (const auto & found = table.find(name); found != table.end()) {
+            return found->second;
+        }
+        if (pos == 0) {
+            return 0;
+        }
+        pos = dom.position(dom.idom(dom.blocks[pos]));
+    }
+}
 
 } // namespace
 
-bool insert_phis(BasicBlock * block, ValueTable & values) {
-    // If there is only one path into this block then we don't need to worry
-    // about variables, they should already be strictly dominated in the parent
-    // blocks.
-    if (block->parents.empty() || is_strictly_dominated(block)) {
-        return false;
-    }
+bool insert_phis(BasicBlock * root, ValueTable & values) {
+    const DominatorTree dom{root};
+    const std::size_t size = dom.blocks.size();
 
     /*
-     * Now calculate the phi nodes
-     *
-     * We can't rely on all branches defining all variables (we haven't checked
-     * things like, does this branch actually continue?)
-     * https://github.com/dcbaker/meson-plus-plus/issues/57
-     *
-     * So, we need to check each parent for variables, and if they exist in more
-     * than one branch we need to insert a phi node.
+     * Walk every instruction exactly once, recording the last definition of
+     * each variable in each block, and which blocks define each variable.
      *
-     * XXX: What happens if a variable is erroniously undefined in a branch?
+     * Any phis already in a block are definitions, and we don't want to add
+     * them again.
      */
-    std::list<Object> phis{};
-
-    // Find all phis in the block arleady, so we don't re-add them
-    std::set<Phi *, PhiComparator> existing_phis{};
-    for (const auto & obj : block->instructions) {
-        if (std::holds_alternative<std::unique_ptr<Phi>>(obj)) {
-            existing_phis.emplace(std::get<std::unique_ptr<Phi>>(obj).get());
+    std::vector<DefinitionTable> defs(size);
+    std::vector<std::set<std::string>> existing(size);
+    std::map<std::string, std::vector<std::size_t>> sites{};
+    for (std::size_t i = 0; i < size; ++i) {
+        for (const auto & obj : dom.blocks[i]->instructions) {
+            if (const auto & var = std::visit(get_variable, obj)) {
+                defs[i][var.name] = var.version;
+                auto & s = sites[var.name];
+                if (s.empty() || s.back() != i) {
+                    s.emplace_back(i);
+                }
+                if (std::holds_alternative<std::unique_ptr<Phi>>(obj)) {
+                    existing[i].emplace(var.name);
+                }
+            }
         }
     }
 
-    // Create a set of all variables in all parents, and one of dominated variables
-    // TODO: we could probably do less rewalking here
-    std::set<std::string> all_vars{};
-    std::set<std::string> dominated{};
-    for (const auto & p : block->parents) {
-        for (const auto & i : p->instructions) {
-            if (auto v = std::visit(get_variable, i)) {
-                if (all_vars.count(v.name)) {
-                    dominated.emplace(v.name);
+    // Place phis on the iterated dominance frontier of the blocks defining
+    // each variable.
+    std::vector<std::set<std::string>> needed(size);
+    for (const auto & [name, blocks] : sites) {
+        std::vector<std::size_t> work{blocks};
+        std::set<std::size_t> placed{};
+        while (!work.empty()) {
+            const std::size_t b = work.back();
+            work.pop_back();
+            for (const auto & f : dom.frontier(dom.blocks[b])) {
+                const std::size_t pos = dom.position(f);
+                if (placed.emplace(pos).second) {
+                    if (!existing[pos].count(name)) {
+                        needed[pos].emplace(name);
+                    }
+                    work.emplace_back(pos);
                 }
-                all_vars.emplace(v.name);
             }
         }
     }
 
-    // For variables that are dominated, create phi nodes. The first value will
-    // be a phi of two parent values, but any additional phis will be either the
-    // previous phi or a parent value.
-    for (const auto & name : dominated) {
-        uint32_t last = 0;
-        for (const auto p : block->parents) {
-            for (const auto & i : reverse(p->instructions)) {
-                if (const auto & var = std::visit(get_variable, i)) {
-                    if (last) {
-                        auto phi = std::make_unique<Phi>(last, var.version, Variable{name});
-                        if (!existing_phis.count(phi.get())) {
-                            // Only set the version if we're actually using this phi
-                            phi->var.version = ++values[name];
-                            last = phi->var.version;
-                            phis.emplace_back(std::move(phi));
-                        }
-                    } else {
-                        last = var.version;
-                    }
-                    break;
+    /*
+     * Now fill in the phis. We do this in reverse post order, so that every
+     * parent, and the phis it contains, has been handled before we look at a
+     * block.
+     *
+     * Our phis only have two values, so a block with more than two parents
+     * gets a chain of phis, the first one being a phi of two parent values,
+     * and any additional phis being of the previous phi and a parent value.
+     *
+     * We can't rely on all branches defining all variables (we haven't
+     * checked things like, does this branch actually continue?)
+     * https://github.com/dcbaker/meson-plus-plus/issues/57
+     *
+     * So a parent that the variable doesn't reach doesn't get a value in the
+     * phi, and if only one value reaches then we don't need a phi at all.
+     */
+    bool progress = false;
+    for (std::size_t i = 1; i < size; ++i) {
+        if (needed[i].empty()) {
+            continue;
+        }
+        BasicBlock * block = dom.blocks[i];
+
+        std::list<Object> phis{};
+        for (const auto & name : needed[i]) {
+            uint32_t last = 0;
+            for (const auto & p : dom.predecessors(block)) {
+                const uint32_t version = reaching_definition(p, name, dom, defs);
+                if (version == 0 || version == last) {
+                    continue;
                 }
+                if (last) {
+                    auto phi = std::make_unique<Phi>(last, version, Variable{name});
+                    phi->var.version = ++values[name];
+                    last = phi->var.version;
+                    phis.emplace_back(std::move(phi));
+                } else {
+                    last = version;
+                }
+            }
+
+            // A definition in the block itself shadows the phi
+            if (last) {
+                defs[i].emplace(name, last);
             }
         }
-    }
 
-    if (phis.empty()) {
-        return false;
+        if (!phis.empty()) {
+            block->instructions.splice(block->instructions.begin(), phis);
+            progress = true;
+        }
     }
 
-    block->instructions.splice(block->instructions.begin(), phis);
-    return true;
+    return progress;
 }
 
 bool fixup_phis(BasicBlock * block) {
+    // Collect the versions of each variable each parent defines, in order, so
+    // that we only walk the parents once, instead of once per phi
+    std::vector<std::unordered_map<std::string, std::vector<uint32_t>>> parent_defs{};
+    for (const auto & p : block->parents) {
+        auto & table = parent_defs.emplace_back();
+        for (const Object & i : p->instructions) {
+            const auto & var = std::visit(get_variable, i);
+            if (var) {
+                table[var.name].emplace_back(var.version);
+            }
+        }
+    }
+
+    // The last version of each variable defined in this block so far
+    DefinitionTable local{};
+
     bool progress = false;
     for (auto it = block->instructions.begin(); it != block->instructions.end(); ++it) {
         if (std::holds_alternative<std::unique_ptr<Phi>>(*it)) {
             const auto & phi = std::get<std::unique_ptr<Phi>>(*it);
             bool right = false;
             bool left = false;
-            for (const auto & p : block->parents) {
-                for (const Object & i : p->instructions) {
-                    const auto & var = std::visit([](const auto & obj) { return obj->var; }, i);
-                    if (var.name == phi->var.name) {
-                        if (var.version == phi->left) {
+
+            // Only the first definition of either side in each parent counts
+            for (const auto & table : parent_defs) {
+                if (const auto & found = table.find(phi->var.name); found != table.end()) {
+                    for (const auto & v : found->second) {
+                        if (v == phi->left) {
                             left = true;
                             break;
-                        } else if (var.version == phi->right) {
+                        } else if (v == phi->right) {
                             right = true;
                             break;
                         }
@@ -132,24 +193,14 @@ bool fixup_phis(BasicBlock * block) {
                 }
             }
 
-            if (left ^ right) {
-                progress = true;
-                auto id = std::make_unique<Identifier>(phi->var.name, left ? phi->left : phi->right,
-                                                       Variable{phi->var});
-                it = block->instructions.erase(it);
-                it = block->instructions.emplace(it, std::move(id));
-                continue;
-            }
-
             // While we are walking the instructions in this block, we know that
             // if one side was found, then the other is found that the first
             // found is dead code after the second, so we can ignore it and
             // treat the second one as the truth
-            for (auto it2 = block->instructions.begin(); it2 != it; ++it2) {
-                const auto & var = std::visit([](const auto & obj) { return obj->var; }, *it2);
-                if (var.name == phi->var.name) {
-                    left = var.version == phi->left;
-                    right = var.version == phi->right;
+            if (!(left ^ right)) {
+                if (const auto & found = local.find(phi->var.name); found != local.end()) {
+                    left = found->second == phi->left;
+                    right = found->second == phi->right;
                 }
             }
 
@@ -161,6 +212,10 @@ bool fixup_phis(BasicBlock * block) {
                 it = block->instructions.emplace(it, std::move(id));
             }
         }
+
+        if (const auto & var = std::visit(get_variable, *it)) {
+            local[var.name] = var.version;
+        }
     }
     return progress;
 }
@@ -58,8 +58,77 @@ bool function_argument_walker(Object &, const MutationCallback &);
  */
 bool block_walker(BasicBlock *, const std::vector<BlockWalkerCb> &);
 
+/**
+ * Walk over all basic blocks starting with the provided one, applying the
+ * given callbacks to many blocks at once
+ *
+ * Each block is visited exactly once. The callbacks must only change the block
+ * they are given, must not change the shape of the CFG, and may only read
+ * shared state (such as State::Persistant). Passes that don't meet those
+ * requirements must be run with the block_walker.
+ */
+bool parallel_block_walker(BasicBlock *, const std::vector<BlockWalkerCb> &);
+
 /// Check if all of the arguments have been reduced from ids
 bool all_args_reduced(const std::vector<Object> & pos_args,
                       const std::unordered_map<std::string, Object> & kw_args);
 
+/**
+ * Lowering for operators and methods that produce constants
+ *
+ * These require that the arguments (and holder) have already been reduced, and
+ * are shared between the lowering passes and sccp.
+ */
+std::optional<Object> lower_not(const FunctionCall &);
+std::optional<Object> lower_eq(const FunctionCall &);
+std::optional<Object> lower_ne(const FunctionCall &);
+std::optional<Object> lower_version_compare(const FunctionCall &);
+
+/**
+ * Dominance information for a CFG
+ *
+ * Calculated once for the CFG reachable from the root block, using the
+ * algorithm from Cooper, Harvey, and Kennedy's "A Simple, Fast Dominance
+ * Algorithm". Any pass that changes the shape of the CFG invalidates this, and
+ * it must be recalculated.
+ *
+ * Blocks are stored in reverse post order, which for our acyclic CFGs means
+ * that every block comes after all of it's parents.
+ */
+class DominatorTree {
+  public:
+    DominatorTree(BasicBlock * root);
+
+    /// All reachable blocks, in reverse post order
+    std::vector<BasicBlock *> blocks;
+
+    /// Get the position of a block in `blocks`
+    std::size_t position(const BasicBlock *) const;
+
+    /// Whether this block is reachable from the root
+    bool contains(const BasicBlock *) const;
+
+    /// The reachable blocks with an edge to this block, ordered by index
+    const std::vector<BasicBlock *> & predecessors(const BasicBlock *) const;
+
+    /// The immediate dominator of a block, the root is its own dominator
+    BasicBlock * idom(const BasicBlock *) const;
+
+    /// The blocks that are immediately dominated by this block
+    const std::vector<BasicBlock *> & children(const BasicBlock *) const;
+
+    /// The dominance frontier of a block
+    const std::vector<BasicBlock *> & frontier(const BasicBlock *) const;
+
+    /// Does `a` dominate `b`?
+    bool dominates(const BasicBlock * a, const BasicBlock * b) const;
+
+  private:
+    std::unordered_map<const BasicBlock *, std::size_t> positions;
+    std::vector<std::vector<BasicBlock *>> preds;
+    std::vector<std::size_t> idoms;
+    std::vector<std::vector<BasicBlock *>> dom_children;
+    std::vector<std::vector<BasicBlock *>> frontiers;
+};
+
 } // namespace MIR::Passes
@@ -48,7 +48,7 @@ std::optional<Object> lower_program_methods_impl(const Object & obj,
 
 } // namespace
 
-bool lower_program_objects(BasicBlock & block, State::Persistant & pstate) {
+bool lower_program_objects(BasicBlock & block, const State::Persistant & pstate) {
     return function_walker(
         &block, [&](const Object & obj) { return lower_program_methods_impl(obj, pstate); });
 }
@@ -0,0 +1,292 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <utility>
+
+#include "passes.hpp"
+#include "private.hpp"
+
+namespace MIR::Passes {
+
+namespace {
+
+/// The constant values that sccp is able to reason about
+using Constant = std::variant<std::shared_ptr<Boolean>, std::shared_ptr<Number>,
+                              std::shared_ptr<String>, std::shared_ptr<Dependency>>;
+
+/**
+ * The lattice of values
+ *
+ * Anything in the table is known to be constant, anything not in the table is
+ * either not defined on an executable path, or is overdefined.
+ */
+using ConstantTable = std::map<Variable, Constant>;
+
+const auto get_var = [](const auto & o) { return o->var; };
+
+std::optional<Constant> as_constant(const Object & obj) {
+    if (std::holds_alternative<std::shared_ptr<Boolean>>(obj)) {
+        return std::get<std::shared_ptr<Boolean>>(obj);
+    } else if (std::holds_alternative<std::shared_ptr<Number>>(obj)) {
+        return std::get<std::shared_ptr<Number>>(obj);
+    } else if (std::holds_alternative<std::shared_ptr<String>>(obj)) {
+        return std::get<std::shared_ptr<String>>(obj);
+    } else if (std::holds_alternative<std::shared_ptr<Dependency>>(obj)) {
+        return std::get<std::shared_ptr<Dependency>>(obj);
+    }
+    return std::nullopt;
+}
+
+Object to_object(const Constant & c) {
+    return std::visit([](const auto & v) -> Object { return v; }, c);
+}
+
+/// Are two constants the same value?
+bool same_value(const Constant & l, const Constant & r) {
+    if (l.index() != r.index()) {
+        return false;
+    }
+    if (std::holds_alternative<std::shared_ptr<Boolean>>(l)) {
+        return std::get<std::shared_ptr<Boolean>>(l)->value ==
+               std::get<std::shared_ptr<Boolean>>(r)->value;
+    } else if (std::holds_alternative<std::shared_ptr<Number>>(l)) {
+        return std::get<std::shared_ptr<Number>>(l)->value ==
+               std::get<std::shared_ptr<Number>>(r)->value;
+    } else if (std::holds_alternative<std::shared_ptr<String>>(l)) {
+        return std::get<std::shared_ptr<String>>(l)->value ==
+               std::get<std::shared_ptr<String>>(r)->value;
+    }
+    return std::get<std::shared_ptr<Dependency>>(l) == std::get<std::shared_ptr<Dependency>>(r);
+}
+
+std::optional<Constant> evaluate(const Object & obj, const ConstantTable & table);
+
+/**
+ * Evaluate the function calls that produce constants
+ *
+ * This builds a temporary call with the constant values substituted in and
+ * hands it to the same lowering the passes use, so that the semantics (and
+ * error messages) are the same.
+ */
+std::optional<Constant> evaluate_call(const FunctionCall & f, const ConstantTable & table) {
+    if (!f.kw_args.empty()) {
+        return std::nullopt;
+    }
+
+    std::optional<Constant> holder = std::nullopt;
+    if (f.holder) {
+        holder = evaluate(f.holder.value(), table);
+        if (!holder) {
+            return std::nullopt;
+        }
+    }
+
+    std::vector<Object> args{};
+    for (const auto & a : f.pos_args) {
+        auto v = evaluate(a, table);
+        if (!v) {
+            return std::nullopt;
+        }
+        args.emplace_back(to_object(v.value()));
+    }
+
+    std::optional<Object> result = std::nullopt;
+    if (!holder) {
+        if (f.name == "rel_eq" || f.name == "rel_ne") {
+            FunctionCall call{f.name, std::move(args), f.source_dir};
+            result = f.name == "rel_eq" ? lower_eq(call) : lower_ne(call);
+        } else if (f.name == "unary_not" && args.size() == 1 &&
+                   std::holds_alternative<std::shared_ptr<Boolean>>(args[0])) {
+            result = lower_not(FunctionCall{f.name, std::move(args), f.source_dir});
+        }
+    } else if (std::holds_alternative<std::shared_ptr<String>>(holder.value())) {
+        if (f.name == "version_compare" && args.size() == 1 &&
+            std::holds_alternative<std::shared_ptr<String>>(args[0])) {
+            FunctionCall call{f.name, std::move(args), f.source_dir};
+            call.holder = to_object(holder.value());
+            result = lower_version_compare(call);
+        }
+    } else if (std::holds_alternative<std::shared_ptr<Dependency>>(holder.value())) {
+        if (f.name == "found" && args.empty()) {
+            return std::make_shared<Boolean>(
+                std::get<std::shared_ptr<Dependency>>(holder.value())->found);
+        }
+    }
+
+    if (result) {
+        return as_constant(result.value());
+    }
+    return std::nullopt;
+}
+
+/// Get the constant value of an object, if it has one
+std::optional<Constant> evaluate(const Object & obj, const ConstantTable & table) {
+    if (auto c = as_constant(obj)) {
+        return c;
+    } else if (std::holds_alternative<std::unique_ptr<Identifier>>(obj)) {
+        const auto & id = std::get<std::unique_ptr<Identifier>>(obj);
+        // An identifier without a version hasn't been numbered yet, so we
+        // can't know which definition it refers to
+        if (id->version == 0) {
+            return std::nullopt;
+        }
+        if (const auto & found = table.find(Variable{id->value, id->version});
+            found != table.end()) {
+            return found->second;
+        }
+    } else if (std::holds_alternative<std::shared_ptr<FunctionCall>>(obj)) {
+        return evaluate_call(*std::get<std::shared_ptr<FunctionCall>>(obj), table);
+    }
+    return std::nullopt;
+}
+
+/// A CFG edge, from a predecessor to its successor
+using Edge = std::pair<const BasicBlock *, const BasicBlock *>;
+
+/// The block each variable is defined in
+using DefinitionTable = std::map<Variable, const BasicBlock *>;
+
+/**
+ * Find which side of a phi reaches the end of a predecessor
+ *
+ * A side reaches it if its definition dominates the predecessor. If both do,
+ * the one defined closer to the predecessor shadows the other.
+ */
+std::optional<Variable> reaching(const Phi & phi, const BasicBlock * pred,
+                                 const DefinitionTable & defs, const DominatorTree & dom) {
+    std::optional<Variable> best = std::nullopt;
+    const BasicBlock * best_block = nullptr;
+    for (const auto & version : {phi.left, phi.right}) {
+        const Variable var{phi.var.name, version};
+        const auto & def = defs.find(var);
+        if (def == defs.end() || !dom.dominates(def->second, pred)) {
+            continue;
+        }
+        // Within one block the later definition has the higher version
+        if (!best || (def->second == best_block ? version > best->version
+                                                : dom.dominates(best_block, def->second))) {
+            best = var;
+            best_block = def->second;
+        }
+    }
+    return best;
+}
+
+/**
+ * Evaluate a phi
+ *
+ * Only the values flowing in over executable edges are considered. The phi is
+ * constant if they are all the same constant.
+ */
+std::optional<Constant> evaluate_phi(const Phi & phi, const BasicBlock * block,
+                                     const ConstantTable & table, const DefinitionTable & defs,
+                                     const std::set<Edge> & edges, const DominatorTree & dom) {
+    std::optional<Constant> value = std::nullopt;
+    for (const BasicBlock * pred : dom.predecessors(block)) {
+        if (!edges.count(Edge{pred, block})) {
+            continue;
+        }
+        const auto & var = reaching(phi, pred, defs, dom);
+        if (!var) {
+            return std::nullopt;
+        }
+        const auto & found = table.find(var.value());
+        if (found == table.end()) {
+            return std::nullopt;
+        }
+        if (!value) {
+            value = found->second;
+        } else if (!same_value(value.value(), found->second)) {
+            return std::nullopt;
+        }
+    }
+    return value;
+}
+
+} // namespace
+
+bool sccp(BasicBlock * root) {
+    const DominatorTree dom{root};
+
+    ConstantTable table{};
+    DefinitionTable defs{};
+    std::set<Edge> edges{};
+    bool progress = false;
+
+    const auto & is_executable = [&](const BasicBlock * block) {
+        if (block == root) {
+            return true;
+        }
+        const auto & preds = dom.predecessors(block);
+        return std::any_of(preds.begin(), preds.end(),
+                           [&](const BasicBlock * p) { return edges.count(Edge{p, block}); });
+    };
+
+    // Our CFGs are acyclic, so walking in reverse post order means that every
+    // executable edge into a block has been found before the block itself is
+    // evaluated, and a single walk reaches the fixed point.
+    for (BasicBlock * block : dom.blocks) {
+        if (!is_executable(block)) {
+            continue;
+        }
+
+        for (auto & obj : block->instructions) {
+            const Variable var = std::visit(get_var, obj);
+            if (!var) {
+                continue;
+            }
+            defs[var] = block;
+
+            std::optional<Constant> value = std::nullopt;
+            if (auto c = as_constant(obj)) {
+                value = c;
+            } else if (std::holds_alternative<std::unique_ptr<Identifier>>(obj)) {
+                value = evaluate(obj, table);
+            } else if (std::holds_alternative<std::unique_ptr<Phi>>(obj)) {
+                value = evaluate_phi(*std::get<std::unique_ptr<Phi>>(obj), block, table, defs,
+                                     edges, dom);
+            } else if (std::holds_alternative<std::shared_ptr<FunctionCall>>(obj)) {
+                value = evaluate(obj, table);
+                // Every call we can fold produces a boolean, replace the call
+                // with it
+                if (value) {
+                    obj = std::make_shared<Boolean>(
+                        std::get<std::shared_ptr<Boolean>>(value.value())->value, var);
+                    progress = true;
+                }
+            }
+
+            if (value) {
+                table[var] = value.value();
+            }
+        }
+
+        if (std::holds_alternative<std::unique_ptr<Condition>>(block->next)) {
+            auto & con = std::get<std::unique_ptr<Condition>>(block->next);
+            const auto & value = evaluate(con->condition, table);
+            if (value && std::holds_alternative<std::shared_ptr<Boolean>>(value.value())) {
+                const bool v = std::get<std::shared_ptr<Boolean>>(value.value())->value;
+                edges.emplace(block, v ? con->if_true.get() : con->if_false.get());
+
+                // Replace the condition so that branch_pruning can remove the
+                // dead arm without waiting on the rest of the lowering.
+                if (!std::holds_alternative<std::shared_ptr<Boolean>>(con->condition)) {
+                    con->condition = std::make_shared<Boolean>(v);
+                    progress = true;
+                }
+            } else {
+                edges.emplace(block, con->if_true.get());
+                edges.emplace(block, con->if_false.get());
+            }
+        } else if (std::holds_alternative<std::shared_ptr<BasicBlock>>(block->next)) {
+            edges.emplace(block, std::get<std::shared_ptr<BasicBlock>>(block->next).get());
+        }
+    }
+
+    return progress;
+}
+
+} // namespace MIR::Passes
@@ -9,9 +9,7 @@
 
 namespace MIR::Passes {
 
-namespace {
-
-std::optional<Object> lower_version_compare_method(const FunctionCall & f) {
+std::optional<Object> lower_version_compare(const FunctionCall & f) {
     if (!f.kw_args.empty()) {
         throw Util::Exceptions::InvalidArguments(
             "string.version_compare() does not take any keyword arguments");
@@ -63,6 +61,8 @@ std::optional<Object> lower_version_compare_method(const FunctionCall & f) {
     return std::make_shared<Boolean>(Version::compare(s.value, op, val));
 }
 
+namespace {
+
 std::optional<Object> lower_string_methods_impl(const Object & obj,
                                                 const State::Persistant & pstate) {
     if (!std::holds_alternative<std::shared_ptr<FunctionCall>>(obj)) {
@@ -80,7 +80,7 @@ std::optional<Object> lower_string_methods_impl(const Object & obj,
     }
 
     if (f.name == "version_compare") {
-        return lower_version_compare_method(f);
+        return lower_version_compare(f);
     }
 
     // XXX: Shouldn't really be able to get here...
@@ -89,7 +89,7 @@ std::optional<Object> lower_string_methods_impl(const Object & obj,
 
 } // namespace
 
-bool lower_string_objects(BasicBlock & block, State::Persistant & pstate) {
+bool lower_string_objects(BasicBlock & block, const State::Persistant & pstate) {
     return function_walker(
         &block, [&](const Object & obj) { return lower_string_methods_impl(obj, pstate); });
 }
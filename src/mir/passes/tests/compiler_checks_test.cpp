@@ -0,0 +1,206 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <filesystem>
+
+#include "passes.hpp"
+#include "passes/private.hpp"
+#include "test_directory.hpp"
+#include "toolchains/checks.hpp"
+#include "toolchains/compilers/cpp/cpp.hpp"
+#include "toolchains/linker.hpp"
+#include "toolchains/toolchain.hpp"
+
+#include "test_utils.hpp"
+
+namespace {
+
+class CompilerChecksTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        auto comp = MIR::Toolchain::Compiler::detect_compiler(MIR::Toolchain::Language::CPP,
+                                                              MIR::Machines::Machine::BUILD);
+        if (comp == nullptr) {
+            GTEST_SKIP() << "No C++ compiler";
+        }
+        toolchain = std::make_shared<MIR::Toolchain::Toolchain>(std::move(comp), nullptr);
+    }
+
+    /// Lower a single call to a compiler method, held by `cc`
+    MIR::Object check(const std::string & src) {
+        auto irlist = lower(src);
+        auto & f = *std::get<std::shared_ptr<MIR::FunctionCall>>(irlist.instructions.front());
+        f.holder = std::make_shared<MIR::Compiler>(toolchain);
+
+        MIR::Passes::CompilerChecker checker{cache_dir};
+        MIR::Passes::compiler_checks(&irlist, checker, MIR::Passes::LookupMode::POLL);
+        EXPECT_TRUE(
+            MIR::Passes::compiler_checks(&irlist, checker, MIR::Passes::LookupMode::FINAL) ||
+            !std::holds_alternative<std::shared_ptr<MIR::FunctionCall>>(
+                irlist.instructions.front()));
+        return std::move(irlist.instructions.front());
+    }
+
+    bool check_bool(const std::string & src) {
+        const auto & obj = check(src);
+        EXPECT_TRUE(std::holds_alternative<std::shared_ptr<MIR::Boolean>>(obj));
+        return std::get<std::shared_ptr<MIR::Boolean>>(obj)->value;
+    }
+
+    std::shared_ptr<MIR::Toolchain::Toolchain> toolchain;
+    const Util::TestDirectory tmp{};
+    /// Created by the checker, when there is something to cache
+    const std::filesystem::path cache_dir = tmp.path / "checks";
+};
+
+} // namespace
+
+TEST_F(CompilerChecksTest, has_header) {
+    ASSERT_TRUE(check_bool("x = cc.has_header('stdio.h')"));
+    ASSERT_FALSE(check_bool("x = cc.has_header('this/header/does/not/exist.h')"));
+}
+
+TEST_F(CompilerChecksTest, compiles) {
+    ASSERT_TRUE(check_bool("x = cc.compiles('int foo(void) { return 0; }')"));
+    ASSERT_FALSE(check_bool("x = cc.compiles('this is not code')"));
+}
+
+TEST_F(CompilerChecksTest, links) {
+    ASSERT_TRUE(check_bool("x = cc.links('int main(void) { return 0; }')"));
+    ASSERT_FALSE(check_bool("x = cc.links('int foo(void) { return 0; }')"));
+}
+
+TEST_F(CompilerChecksTest, has_function) {
+    ASSERT_TRUE(check_bool("x = cc.has_function('printf', prefix : '#include <stdio.h>')"));
+    ASSERT_TRUE(check_bool("x = cc.has_function('malloc')"));
+    ASSERT_FALSE(check_bool("x = cc.has_function('this_function_does_not_exist')"));
+}
+
+TEST_F(CompilerChecksTest, has_argument) {
+    ASSERT_TRUE(check_bool("x = cc.has_argument('-Wall')"));
+    ASSERT_FALSE(check_bool("x = cc.has_argument('-Wthis-is-not-an-argument')"));
+}
+
+TEST_F(CompilerChecksTest, get_supported_arguments) {
+    const auto & obj =
+        check("x = cc.get_supported_arguments(['-Wall', '-Wthis-is-not-an-argument', '-Wextra'])");
+    ASSERT_TRUE(std::holds_alternative<std::shared_ptr<MIR::Array>>(obj));
+    const auto & arr = std::get<std::shared_ptr<MIR::Array>>(obj)->value;
+    ASSERT_EQ(arr.size(), 2);
+    ASSERT_EQ(std::get<std::shared_ptr<MIR::String>>(arr[0])->value, "-Wall");
+    ASSERT_EQ(std::get<std::shared_ptr<MIR::String>>(arr[1])->value, "-Wextra");
+}
+
+TEST_F(CompilerChecksTest, sizeof) {
+    const auto & obj = check("x = cc.sizeof('char')");
+    ASSERT_TRUE(std::holds_alternative<std::shared_ptr<MIR::Number>>(obj));
+    ASSERT_EQ(std::get<std::shared_ptr<MIR::Number>>(obj)->value, 1);
+}
+
+TEST_F(CompilerChecksTest, sizeof_predefined) {
+    // A compiler that can't run anything, so the size must come from the macros
+    toolchain = std::make_shared<MIR::Toolchain::Toolchain>(
+        std::make_unique<MIR::Toolchain::Compiler::CPP::Gnu>(
+            std::vector<std::string>{"false"}, "", std::unordered_map<std::string, std::string>{
+                                                       {"__SIZEOF_LONG__", "8"}}),
+        nullptr);
+
+    const auto & obj = check("x = cc.sizeof('unsigned long')");
+    ASSERT_TRUE(std::holds_alternative<std::shared_ptr<MIR::Number>>(obj));
+    ASSERT_EQ(std::get<std::shared_ptr<MIR::Number>>(obj)->value, 8);
+
+    // A prefix could change the type, so the check has to be run
+    const auto & prefixed = check("x = cc.sizeof('long', prefix : '#define long char')");
+    ASSERT_TRUE(std::holds_alternative<std::shared_ptr<MIR::Number>>(prefixed));
+    ASSERT_EQ(std::get<std::shared_ptr<MIR::Number>>(prefixed)->value, -1);
+}
+
+TEST_F(CompilerChecksTest, alignment) {
+    const auto & obj = check("x = cc.alignment('char')");
+    ASSERT_TRUE(std::holds_alternative<std::shared_ptr<MIR::Number>>(obj));
+    ASSERT_EQ(std::get<std::shared_ptr<MIR::Number>>(obj)->value, 1);
+}
+
+TEST_F(CompilerChecksTest, cached) {
+    const MIR::Toolchain::Compiler::CheckCache cache{cache_dir};
+    const MIR::Toolchain::Compiler::Check c{MIR::Toolchain::Compiler::CheckMode::COMPILE,
+                                            "int i;\n", {"-Wall"}};
+    const auto & key = MIR::Toolchain::Compiler::check_key(*toolchain->compiler, nullptr, c);
+    ASSERT_FALSE(cache.get(key).has_value());
+
+    ASSERT_TRUE(check_bool("x = cc.has_argument('-Wall')"));
+
+    const auto & r = cache.get(key);
+    ASSERT_TRUE(r.has_value());
+    ASSERT_TRUE(r->success);
+}
+
+TEST_F(CompilerChecksTest, not_cached) {
+    // Whether a header exists depends on what's installed, which can change
+    // between configurations
+    ASSERT_TRUE(check_bool("x = cc.has_header('stdio.h')"));
+    ASSERT_FALSE(std::filesystem::exists(cache_dir));
+}
+
+TEST_F(CompilerChecksTest, key) {
+    namespace TC = MIR::Toolchain::Compiler;
+    namespace TL = MIR::Toolchain::Linker;
+    const auto & comp = *toolchain->compiler;
+    const TC::Check c{TC::CheckMode::LINK, "int main(void) { return 0; }\n", {}};
+
+    const TL::Drivers::Gnu bfd{std::make_unique<TL::GnuBFD>(std::vector<std::string>{"ld.bfd"}),
+                               &comp};
+    const TL::Drivers::Gnu gold{std::make_unique<TL::GnuGold>(std::vector<std::string>{"ld.gold"}),
+                                &comp, true};
+    const auto & key = TC::check_key(comp, &bfd, c);
+    ASSERT_NE(key, TC::check_key(comp, &gold, c));
+
+    const char * old = std::getenv("LIBRARY_PATH");
+    const std::string saved = old != nullptr ? old : "";
+    setenv("LIBRARY_PATH", "/meson-test-does-not-exist", 1);
+    const auto & changed = TC::check_key(comp, &bfd, c);
+    if (old != nullptr) {
+        setenv("LIBRARY_PATH", saved.c_str(), 1);
+    } else {
+        unsetenv("LIBRARY_PATH");
+    }
+    ASSERT_NE(key, changed);
+}
+
+TEST_F(CompilerChecksTest, batched_arguments) {
+    namespace TC = MIR::Toolchain::Compiler;
+    const auto & comp = *toolchain->compiler;
+
+    std::vector<TC::Check> checks{};
+    for (const auto & a : {"-Wall", "-Wthis-is-not-an-argument", "-Wextra", "-fnot-a-flag",
+                           "-Wno-also-not-an-argument", "-O9x", "-Wshadow", "-Wformat=9",
+                           "-march=not-a-cpu", "-Wno-unused"}) {
+        checks.emplace_back(TC::Check{TC::CheckMode::COMPILE, "int i;\n", comp.check_argument(a)});
+    }
+
+    const auto & batched = TC::run_argument_checks(comp, checks);
+    ASSERT_EQ(batched.size(), checks.size());
+    for (std::size_t i = 0; i < checks.size(); ++i) {
+        EXPECT_EQ(batched[i].success, TC::run_check(comp, nullptr, checks[i]).success)
+            << "for argument " << checks[i].args.front();
+    }
+}
+
+TEST(unsupported_arguments, gnulike) {
+    const MIR::Toolchain::Compiler::CPP::Gnu gnu{{"c++"}};
+    const auto & args =
+        gnu.unsupported_arguments("g++: error: unrecognized command-line option '-Wfoo'\n"
+                                  "cc1plus: error: unrecognized command-line option "
+                                  "\xe2\x80\x98-fbar\xe2\x80\x99; did you mean "
+                                  "\xe2\x80\x98-fbaz\xe2\x80\x99?\n"
+                                  "error: unknown warning option '-Wqux' "
+                                  "[-Werror,-Wunknown-warning-option]\n"
+                                  "clang: error: unknown argument: '--bogus'\n"
+                                  "cc1plus: error: argument to '-O' should be a non-negative "
+                                  "integer\n"
+                                  "warning: unrecognized command-line option '-Wwarned'\n");
+    ASSERT_EQ(args, (std::vector<std::string>{"-Wfoo", "-fbar", "-Wqux", "--bogus"}));
+}
@@ -58,10 +58,8 @@ TEST(constant_folding, with_phi) {
     // Do this in two passes as otherwise the phi won't get inserted, and thus y will point at the
     // wrong thing
     MIR::Passes::block_walker(
-        &irlist, {
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, data); },
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::insert_phis(b, data); },
-                 });
+        &irlist, {[&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, data); }});
+    MIR::Passes::insert_phis(&irlist, data);
     MIR::Passes::block_walker(
         &irlist, {
                      MIR::Passes::branch_pruning,
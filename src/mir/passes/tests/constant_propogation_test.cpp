@@ -25,10 +25,11 @@ TEST(constant_propogation, phi_should_not_propogate) {
 
     // We do this in two walks because we don't have all of passes necissary to
     // get the state we want to test.
+    MIR::Passes::block_walker(
+        &irlist, {[&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, vt); }});
+    MIR::Passes::insert_phis(&irlist, vt);
     MIR::Passes::block_walker(
         &irlist, {
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, vt); },
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::insert_phis(b, vt); },
                      [&](MIR::BasicBlock * b) { return MIR::Passes::usage_numbering(b, lst); },
                      [&](MIR::BasicBlock * b) { return MIR::Passes::constant_folding(b, rt); },
                      [&](MIR::BasicBlock * b) { return MIR::Passes::constant_propogation(b, pt); },
@@ -74,9 +75,12 @@ TEST(constant_propogation, function_arguments) {
     MIR::Passes::block_walker(
         &irlist, {
                      [&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, vt); },
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::insert_phis(b, vt); },
                      MIR::Passes::branch_pruning,
                      MIR::Passes::join_blocks,
+                 });
+    MIR::Passes::insert_phis(&irlist, vt);
+    MIR::Passes::block_walker(
+        &irlist, {
                      MIR::Passes::fixup_phis,
                      [&](MIR::BasicBlock * b) { return MIR::Passes::usage_numbering(b, lst); },
                      [&](MIR::BasicBlock * b) { return MIR::Passes::constant_folding(b, rt); },
@@ -114,9 +118,12 @@ TEST(constant_propogation, array) {
     MIR::Passes::block_walker(
         &irlist, {
                      [&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, vt); },
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::insert_phis(b, vt); },
                      MIR::Passes::branch_pruning,
                      MIR::Passes::join_blocks,
+                 });
+    MIR::Passes::insert_phis(&irlist, vt);
+    MIR::Passes::block_walker(
+        &irlist, {
                      MIR::Passes::fixup_phis,
                      [&](MIR::BasicBlock * b) { return MIR::Passes::usage_numbering(b, lst); },
                      [&](MIR::BasicBlock * b) { return MIR::Passes::constant_folding(b, rt); },
@@ -145,11 +152,9 @@ TEST(constant_propogation, method_holder) {
     MIR::Passes::PropTable pt{};
     MIR::Passes::ValueTable vt{};
     MIR::State::Persistant pstate{"foo", "bar"};
+    MIR::Passes::ProgramFinder finder{pstate.program_cache};
 
-    MIR::Passes::block_walker(
-        &irlist, {
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::threaded_lowering(b, pstate); },
-                 });
+    MIR::Passes::find_programs(&irlist, pstate, finder, MIR::Passes::LookupMode::WAIT);
     bool progress = MIR::Passes::block_walker(
         &irlist, {
                      [&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, vt); },
@@ -181,11 +186,9 @@ TEST(constant_propogation, into_function_call) {
     MIR::Passes::PropTable pt{};
     MIR::Passes::ValueTable vt{};
     MIR::State::Persistant pstate{"foo", "bar"};
+    MIR::Passes::ProgramFinder finder{pstate.program_cache};
 
-    MIR::Passes::block_walker(
-        &irlist, {
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::threaded_lowering(b, pstate); },
-                 });
+    MIR::Passes::find_programs(&irlist, pstate, finder, MIR::Passes::LookupMode::WAIT);
     bool progress = MIR::Passes::block_walker(
         &irlist,
         {
@@ -208,3 +211,30 @@ TEST(constant_propogation, into_function_call) {
     const auto & f = std::get<std::shared_ptr<MIR::FunctionCall>>(back);
     ASSERT_TRUE(std::holds_alternative<std::shared_ptr<MIR::Boolean>>(f->pos_args[0]));
 }
+
+TEST(constant_propogation, into_condition_holder) {
+    auto irlist = lower(R"EOF(
+        x = '1.0'
+        if x.version_compare('> 0.5')
+            message('foo')
+        endif
+        )EOF");
+    MIR::Passes::LastSeenTable lst{};
+    MIR::Passes::ReplacementTable rt{};
+    MIR::Passes::PropTable pt{};
+    MIR::Passes::ValueTable vt{};
+
+    bool progress = MIR::Passes::block_walker(
+        &irlist, {
+                     [&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, vt); },
+                     [&](MIR::BasicBlock * b) { return MIR::Passes::usage_numbering(b, lst); },
+                     [&](MIR::BasicBlock * b) { return MIR::Passes::constant_folding(b, rt); },
+                     [&](MIR::BasicBlock * b) { return MIR::Passes::constant_propogation(b, pt); },
+                 });
+    ASSERT_TRUE(progress);
+
+    const auto & con = get_con(irlist.next)->condition;
+    ASSERT_TRUE(std::holds_alternative<std::shared_ptr<MIR::FunctionCall>>(con));
+    const auto & f = *std::get<std::shared_ptr<MIR::FunctionCall>>(con);
+    ASSERT_TRUE(std::holds_alternative<std::shared_ptr<MIR::String>>(f.holder.value()));
+}
@@ -0,0 +1,100 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <gtest/gtest.h>
+
+#include "passes.hpp"
+#include "passes/private.hpp"
+
+#include "test_utils.hpp"
+
+namespace {
+
+void number(MIR::BasicBlock & irlist) {
+    MIR::Passes::ValueTable vt{};
+    MIR::Passes::block_walker(
+        &irlist, {[&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, vt); }});
+}
+
+} // namespace
+
+TEST(cse, simple) {
+    auto irlist = lower(R"EOF(
+        x = files('foo.c', 'bar.c')
+        y = files('foo.c', 'bar.c')
+        z = files('bar.c', 'foo.c')
+        )EOF");
+    number(irlist);
+
+    ASSERT_TRUE(MIR::Passes::common_subexpression_elimination(&irlist));
+
+    auto it = irlist.instructions.begin();
+    ASSERT_TRUE(std::holds_alternative<std::shared_ptr<MIR::FunctionCall>>(*it));
+
+    ++it;
+    ASSERT_TRUE(std::holds_alternative<std::unique_ptr<MIR::Identifier>>(*it));
+    const auto & id = *std::get<std::unique_ptr<MIR::Identifier>>(*it);
+    ASSERT_EQ(id.value, "x");
+    ASSERT_EQ(id.version, 1);
+    ASSERT_EQ(id.var.name, "y");
+
+    // The arguments are different
+    ++it;
+    ASSERT_TRUE(std::holds_alternative<std::shared_ptr<MIR::FunctionCall>>(*it));
+}
+
+TEST(cse, keyword_arguments) {
+    auto irlist = lower(R"EOF(
+        x = declare_dependency(compile_args : ['-DFOO'], include_directories : 'inc')
+        y = declare_dependency(include_directories : 'inc', compile_args : ['-DFOO'])
+        )EOF");
+    number(irlist);
+
+    ASSERT_TRUE(MIR::Passes::common_subexpression_elimination(&irlist));
+    ASSERT_TRUE(
+        std::holds_alternative<std::unique_ptr<MIR::Identifier>>(irlist.instructions.back()));
+}
+
+TEST(cse, not_dominated) {
+    auto irlist = lower(R"EOF(
+        if y
+            x = include_directories('inc')
+        else
+            x = include_directories('inc')
+        endif
+        z = include_directories('inc')
+        )EOF");
+    number(irlist);
+
+    ASSERT_FALSE(MIR::Passes::common_subexpression_elimination(&irlist));
+}
+
+TEST(cse, dominated) {
+    auto irlist = lower(R"EOF(
+        x = include_directories('inc')
+        if y
+            z = include_directories('inc')
+        endif
+        )EOF");
+    number(irlist);
+
+    ASSERT_TRUE(MIR::Passes::common_subexpression_elimination(&irlist));
+
+    const auto & branch = get_con(irlist.next)->if_true;
+    ASSERT_TRUE(
+        std::holds_alternative<std::unique_ptr<MIR::Identifier>>(branch->instructions.front()));
+}
+
+TEST(cse, lowered) {
+    auto irlist = lower(R"EOF(
+        x = include_directories('inc')
+        y = include_directories('inc')
+        z = declare_dependency(include_directories : x)
+        w = declare_dependency(include_directories : y)
+        message(z, w)
+        )EOF");
+    MIR::State::Persistant pstate{src_root, build_root};
+    MIR::lower(&irlist, pstate);
+
+    ASSERT_EQ(irlist.instructions.size(), 1);
+}
@@ -64,3 +64,67 @@ TEST(unreachable_code, clear_next) {
     const auto & fin = *get_bb(get_bb(get_con(irlist.next)->if_false)->next);
     ASSERT_EQ(fin.parents.size(), 1);
 }
+
+TEST(unreachable_code, no_progress_once_cleared) {
+    auto irlist = lower(R"EOF(
+        error('should be dead')
+        message('should be deleted')
+        )EOF");
+
+    MIR::State::Persistant pstate{"", ""};
+    MIR::Passes::lower_free_functions(&irlist, pstate);
+
+    ASSERT_TRUE(MIR::Passes::delete_unreachable(irlist));
+    ASSERT_FALSE(MIR::Passes::delete_unreachable(irlist));
+    ASSERT_EQ(irlist.instructions.size(), 1);
+}
+
+TEST(dead_values, unused_values) {
+    auto irlist = lower(R"EOF(
+        x = 'foo'
+        y = ['a', 'b']
+        z = x
+        message(z)
+        include_directories('inc')
+        )EOF");
+    MIR::State::Persistant pstate{src_root, build_root};
+    MIR::lower(&irlist, pstate);
+
+    // Only the message is left, everything else has been propagated into it,
+    // or was never used
+    ASSERT_EQ(irlist.instructions.size(), 1);
+    ASSERT_TRUE(std::holds_alternative<std::unique_ptr<MIR::Message>>(irlist.instructions.front()));
+}
+
+TEST(dead_values, keep_read) {
+    auto irlist = lower(R"EOF(
+        x = 'foo'
+        y = x
+        z = 1
+        )EOF");
+
+    MIR::Passes::ValueTable vt{};
+    MIR::Passes::LastSeenTable lst{};
+    MIR::Passes::block_walker(
+        &irlist, {
+                     [&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, vt); },
+                     [&](MIR::BasicBlock * b) { return MIR::Passes::usage_numbering(b, lst); },
+                 });
+
+    ASSERT_TRUE(MIR::Passes::delete_dead_values(&irlist));
+
+    // y is never read so it goes away, then x isn't read anymore either
+    ASSERT_TRUE(irlist.instructions.empty());
+}
+
+TEST(dead_values, keep_targets) {
+    auto irlist = lower(R"EOF(
+        t = custom_target('gen', output : 'gen.c', command : ['prog', '@OUTPUT@'])
+        )EOF");
+    MIR::State::Persistant pstate{src_root, build_root};
+    MIR::lower(&irlist, pstate);
+
+    ASSERT_EQ(irlist.instructions.size(), 1);
+    ASSERT_TRUE(
+        std::holds_alternative<std::shared_ptr<MIR::CustomTarget>>(irlist.instructions.front()));
+}
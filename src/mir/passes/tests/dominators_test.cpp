@@ -0,0 +1,81 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <gtest/gtest.h>
+
+#include "passes.hpp"
+#include "passes/private.hpp"
+
+#include "test_utils.hpp"
+
+TEST(dominators, no_branches) {
+    auto irlist = lower("x = 9");
+    const MIR::Passes::DominatorTree dom{&irlist};
+
+    ASSERT_EQ(dom.blocks.size(), 1);
+    ASSERT_EQ(dom.blocks.front(), &irlist);
+    ASSERT_EQ(dom.idom(&irlist), &irlist);
+    ASSERT_TRUE(dom.frontier(&irlist).empty());
+}
+
+TEST(dominators, simple) {
+    auto irlist = lower(R"EOF(
+        if true
+            x = 9
+        else
+            x = 10
+        endif
+        )EOF");
+    const MIR::Passes::DominatorTree dom{&irlist};
+
+    const auto & con = get_con(irlist.next);
+    const auto * if_true = con->if_true.get();
+    const auto * if_false = con->if_false.get();
+    const auto * fin = get_bb(if_false->next).get();
+
+    ASSERT_EQ(dom.blocks.size(), 4);
+    ASSERT_EQ(dom.blocks.front(), &irlist);
+    ASSERT_EQ(dom.blocks.back(), fin);
+
+    ASSERT_EQ(dom.idom(if_true), &irlist);
+    ASSERT_EQ(dom.idom(if_false), &irlist);
+    ASSERT_EQ(dom.idom(fin), &irlist);
+    ASSERT_EQ(dom.children(&irlist).size(), 3);
+
+    ASSERT_TRUE(dom.dominates(&irlist, fin));
+    ASSERT_FALSE(dom.dominates(if_true, fin));
+
+    ASSERT_EQ(dom.frontier(if_true).size(), 1);
+    ASSERT_EQ(dom.frontier(if_true).front(), fin);
+    ASSERT_EQ(dom.frontier(if_false).size(), 1);
+    ASSERT_EQ(dom.frontier(if_false).front(), fin);
+    ASSERT_TRUE(dom.frontier(&irlist).empty());
+}
+
+TEST(dominators, nested_branches) {
+    auto irlist = lower(R"EOF(
+        x = 9
+        if true
+            if true
+                x = 11
+            else
+                x = 10
+            endif
+        endif
+        )EOF");
+    const MIR::Passes::DominatorTree dom{&irlist};
+
+    const auto * outer = get_con(irlist.next)->if_true.get();
+    const auto * fin = get_con(irlist.next)->if_false.get();
+    const auto * inner_fin = get_bb(get_con(outer->next)->if_true->next).get();
+
+    ASSERT_EQ(dom.idom(inner_fin), outer);
+    ASSERT_EQ(dom.idom(fin), &irlist);
+    ASSERT_TRUE(dom.dominates(outer, inner_fin));
+
+    // The inner join is in the frontier of the outer branch, through itself
+    ASSERT_EQ(dom.frontier(inner_fin).size(), 1);
+    ASSERT_EQ(dom.frontier(inner_fin).front(), fin);
+    ASSERT_EQ(dom.frontier(outer).size(), 1);
+    ASSERT_EQ(dom.frontier(outer).front(), fin);
+}
@@ -3,10 +3,14 @@
 
 #include <gtest/gtest.h>
 
+#include <fstream>
+
 #include "arguments.hpp"
+#include "exceptions.hpp"
 #include "passes.hpp"
 #include "passes/private.hpp"
 #include "state/state.hpp"
+#include "test_directory.hpp"
 #include "toolchains/archiver.hpp"
 #include "toolchains/common.hpp"
 #include "toolchains/compilers/cpp/cpp.hpp"
@@ -162,11 +166,9 @@ TEST(find_program, found) {
     MIR::Passes::PropTable pt{};
     MIR::Passes::ReplacementTable rt{};
     MIR::State::Persistant pstate{src_root, build_root};
+    MIR::Passes::ProgramFinder finder{pstate.program_cache};
 
-    MIR::Passes::block_walker(
-        &irlist, {
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::threaded_lowering(b, pstate); },
-                 });
+    MIR::Passes::find_programs(&irlist, pstate, finder, MIR::Passes::LookupMode::WAIT);
     bool progress = MIR::Passes::block_walker(
         &irlist,
         {
@@ -187,6 +189,39 @@ TEST(find_program, found) {
     ASSERT_EQ(m->value, true);
 }
 
+TEST(find_program, missing_required_deferred) {
+    auto irlist = lower(R"EOF(
+        x = find_program('this-program-does-not-exist')
+    )EOF");
+    MIR::State::Persistant pstate{src_root, build_root};
+    MIR::Passes::ProgramFinder finder{pstate.program_cache};
+
+    // Until the final sweep the call might still be in a dead branch, so it
+    // must not be an error yet
+    ASSERT_FALSE(
+        MIR::Passes::find_programs(&irlist, pstate, finder, MIR::Passes::LookupMode::POLL));
+    ASSERT_FALSE(
+        MIR::Passes::find_programs(&irlist, pstate, finder, MIR::Passes::LookupMode::WAIT));
+    ASSERT_THROW(
+        MIR::Passes::find_programs(&irlist, pstate, finder, MIR::Passes::LookupMode::FINAL),
+        Util::Exceptions::MesonException);
+}
+
+TEST(find_program, wait) {
+    auto irlist = lower(R"EOF(
+        x = find_program('sh')
+    )EOF");
+    MIR::State::Persistant pstate{src_root, build_root};
+    MIR::Passes::ProgramFinder finder{pstate.program_cache};
+
+    MIR::Passes::find_programs(&irlist, pstate, finder, MIR::Passes::LookupMode::POLL);
+    MIR::Passes::find_programs(&irlist, pstate, finder, MIR::Passes::LookupMode::WAIT);
+
+    const auto & r = irlist.instructions.front();
+    ASSERT_TRUE(std::holds_alternative<std::shared_ptr<MIR::Program>>(r));
+    ASSERT_TRUE(std::get<std::shared_ptr<MIR::Program>>(r)->found());
+}
+
 TEST(not, simple) {
     auto irlist = lower("not false");
     const MIR::State::Persistant pstate{src_root, build_root};
@@ -339,3 +374,35 @@ TEST(declare_dependency, recursive) {
     ASSERT_EQ(d.arguments[0].value, "foo");
     ASSERT_EQ(d.arguments[0].type, MIR::Arguments::Type::DEFINE);
 }
+
+TEST(dependency, broken_not_required) {
+    const Util::TestDirectory tmp{};
+    std::ofstream{tmp.path / "broken.pc"} << "Name: broken\nVersion: 1.0\nCflags: ${nope}\n";
+
+    auto irlist = lower("x = dependency('broken', required : false)");
+    MIR::State::Persistant pstate{src_root, build_root};
+    MIR::Passes::DependencyFinder finder{{tmp.path}};
+
+    // A broken .pc file is the same as a missing one
+    ASSERT_TRUE(
+        MIR::Passes::find_dependencies(&irlist, pstate, finder, MIR::Passes::LookupMode::WAIT));
+    const auto & r = irlist.instructions.front();
+    ASSERT_TRUE(std::holds_alternative<std::shared_ptr<MIR::Dependency>>(r));
+    ASSERT_FALSE(std::get<std::shared_ptr<MIR::Dependency>>(r)->found);
+}
+
+TEST(dependency, broken_required) {
+    const Util::TestDirectory tmp{};
+    std::ofstream{tmp.path / "broken.pc"} << "Name: broken\nVersion: 1.0\nCflags: ${nope}\n";
+
+    auto irlist = lower("x = dependency('broken')");
+    MIR::State::Persistant pstate{src_root, build_root};
+    MIR::Passes::DependencyFinder finder{{tmp.path}};
+
+    // The call may still be pruned, so it's only an error once nothing else can be lowered
+    ASSERT_FALSE(
+        MIR::Passes::find_dependencies(&irlist, pstate, finder, MIR::Passes::LookupMode::WAIT));
+    ASSERT_THROW(
+        MIR::Passes::find_dependencies(&irlist, pstate, finder, MIR::Passes::LookupMode::FINAL),
+        Util::Exceptions::MesonException);
+}
@@ -20,8 +20,8 @@ TEST(insert_compiler, simple) {
     auto comp = std::make_unique<MIR::Toolchain::Compiler::CPP::Clang>(init);
     auto tc = std::make_shared<MIR::Toolchain::Toolchain>(
         std::move(comp),
-        std::make_unique<MIR::Toolchain::Linker::Drivers::Gnu>(MIR::Toolchain::Linker::GnuBFD{init},
-                                                               comp.get()),
+        std::make_unique<MIR::Toolchain::Linker::Drivers::Gnu>(
+            std::make_unique<MIR::Toolchain::Linker::GnuBFD>(init), comp.get()),
         std::make_unique<MIR::Toolchain::Archiver::Gnu>(init));
     std::unordered_map<MIR::Toolchain::Language,
                        MIR::Machines::PerMachine<std::shared_ptr<MIR::Toolchain::Toolchain>>>
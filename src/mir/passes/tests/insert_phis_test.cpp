@@ -20,10 +20,8 @@ TEST(insert_phi, simple) {
     std::unordered_map<std::string, uint32_t> data{};
 
     MIR::Passes::block_walker(
-        &irlist, {
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, data); },
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::insert_phis(b, data); },
-                 });
+        &irlist, {[&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, data); }});
+    MIR::Passes::insert_phis(&irlist, data);
 
     const auto & fin = get_bb(get_con(irlist.next)->if_false->next);
     ASSERT_EQ(fin->instructions.size(), 1);
@@ -49,10 +47,8 @@ TEST(insert_phi, three_branches) {
     std::unordered_map<std::string, uint32_t> data{};
 
     MIR::Passes::block_walker(
-        &irlist, {
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, data); },
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::insert_phis(b, data); },
-                 });
+        &irlist, {[&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, data); }});
+    MIR::Passes::insert_phis(&irlist, data);
 
     const auto & fin = get_bb(get_con(irlist.next)->if_true->next);
     ASSERT_EQ(fin->instructions.size(), 2);
@@ -90,10 +86,8 @@ TEST(insert_phi, nested_branches) {
     std::unordered_map<std::string, uint32_t> data{};
 
     MIR::Passes::block_walker(
-        &irlist, {
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, data); },
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::insert_phis(b, data); },
-                 });
+        &irlist, {[&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, data); }});
+    MIR::Passes::insert_phis(&irlist, data);
 
     {
         const auto & fin =
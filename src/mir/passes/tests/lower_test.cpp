@@ -3,6 +3,9 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <mutex>
+
 #include "passes.hpp"
 #include "passes/private.hpp"
 
@@ -33,6 +36,111 @@ TEST(lower, after_files) {
     ASSERT_TRUE(std::holds_alternative<std::shared_ptr<MIR::CustomTarget>>(ct_obj));
 }
 
+TEST(lower, parallel_block_walker) {
+    auto irlist = lower(R"EOF(
+        if x
+            y = 1
+        elif z
+            y = 2
+        else
+            y = 3
+        endif
+        )EOF");
+
+    std::mutex lock{};
+    std::vector<MIR::BasicBlock *> visited{};
+    const auto cb = [&](MIR::BasicBlock * b) {
+        std::lock_guard l{lock};
+        visited.emplace_back(b);
+        return b == &irlist;
+    };
+    const bool progress = MIR::Passes::parallel_block_walker(&irlist, {cb});
+
+    ASSERT_TRUE(progress);
+
+    // Each block is visited exactly once, even the join block which has
+    // multiple parents
+    ASSERT_EQ(visited.size(), 6);
+    std::sort(visited.begin(), visited.end());
+    ASSERT_EQ(std::unique(visited.begin(), visited.end()), visited.end());
+}
+
+TEST(lower, parallel_block_walker_error) {
+    auto irlist = lower(R"EOF(
+        if x
+            y = 1
+        else
+            y = 3
+        endif
+        )EOF");
+
+    const auto cb = [](MIR::BasicBlock *) -> bool {
+        throw Util::Exceptions::MesonException{"error"};
+    };
+    ASSERT_THROW(MIR::Passes::parallel_block_walker(&irlist, {cb}),
+                 Util::Exceptions::MesonException);
+}
+
+TEST(lower, required_program_in_dead_branch) {
+    // However long the first lookup takes, the second call is pruned before
+    // it's missing program is an error
+    auto irlist = lower(R"EOF(
+        x = find_program('meson-test-does-not-exist-1', required : false)
+        if x.found()
+            find_program('meson-test-does-not-exist-2')
+        endif
+        )EOF");
+    MIR::State::Persistant pstate{src_root, build_root};
+    ASSERT_NO_THROW(MIR::lower(&irlist, pstate));
+}
+
+TEST(lower, required_dependency_in_dead_branch) {
+    auto irlist = lower(R"EOF(
+        x = dependency('meson-test-does-not-exist-1', required : false)
+        if x.found()
+            dependency('meson-test-does-not-exist-2')
+        endif
+        )EOF");
+    MIR::State::Persistant pstate{src_root, build_root};
+    ASSERT_NO_THROW(MIR::lower(&irlist, pstate));
+}
+
+TEST(lower, required_program_missing) {
+    auto irlist = lower(R"EOF(
+        x = find_program('sh', required : false)
+        if x.found()
+            find_program('meson-test-does-not-exist')
+        endif
+        )EOF");
+    MIR::State::Persistant pstate{src_root, build_root};
+    ASSERT_THROW(MIR::lower(&irlist, pstate), Util::Exceptions::MesonException);
+}
+
+TEST(lower, unlowered_array_in_branches) {
+    // The array is used by both branches before it's calls are lowered, each
+    // use must get lowered elements without lowering the same call twice
+    auto irlist = lower(R"EOF(
+        p = find_program('sh', required : false)
+        x = [find_program('sh'), files('foo.c'), '@OUTPUT@']
+        if p.found()
+            custom_target('a', output : 'a.c', command : x)
+        else
+            custom_target('b', output : 'b.c', command : x)
+        endif
+        )EOF");
+    MIR::State::Persistant pstate{src_root, build_root};
+    MIR::lower(&irlist, pstate);
+
+    const auto it = std::find_if(
+        irlist.instructions.begin(), irlist.instructions.end(), [](const MIR::Object & o) {
+            return std::holds_alternative<std::shared_ptr<MIR::CustomTarget>>(o);
+        });
+    ASSERT_NE(it, irlist.instructions.end());
+    const auto & ct = *std::get<std::shared_ptr<MIR::CustomTarget>>(*it);
+    ASSERT_EQ(ct.name, "a");
+    ASSERT_EQ(ct.command.size(), 3);
+}
+
 #if false
 TEST(lower, simple_real) {
     auto irlist = lower(R"EOF(
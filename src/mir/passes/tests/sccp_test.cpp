@@ -0,0 +1,145 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <gtest/gtest.h>
+
+#include "passes.hpp"
+#include "passes/private.hpp"
+
+#include "test_utils.hpp"
+
+namespace {
+
+void number(MIR::BasicBlock & irlist, const bool phis = false) {
+    MIR::Passes::ValueTable vt{};
+    MIR::Passes::LastSeenTable lst{};
+
+    MIR::Passes::block_walker(
+        &irlist, {[&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, vt); }});
+    if (phis) {
+        MIR::Passes::insert_phis(&irlist, vt);
+    }
+    MIR::Passes::block_walker(
+        &irlist, {[&](MIR::BasicBlock * b) { return MIR::Passes::usage_numbering(b, lst); }});
+}
+
+bool get_condition(const MIR::BasicBlock & block) {
+    const auto & con = get_con(block.next);
+    EXPECT_TRUE(std::holds_alternative<std::shared_ptr<MIR::Boolean>>(con->condition));
+    return std::get<std::shared_ptr<MIR::Boolean>>(con->condition)->value;
+}
+
+} // namespace
+
+TEST(sccp, rel_eq) {
+    auto irlist = lower(R"EOF(
+        x = 1
+        if x == 1
+            y = 'a'
+        else
+            y = 'b'
+        endif
+        )EOF");
+    number(irlist);
+
+    ASSERT_TRUE(MIR::Passes::sccp(&irlist));
+    ASSERT_TRUE(get_condition(irlist));
+}
+
+TEST(sccp, rel_ne) {
+    auto irlist = lower(R"EOF(
+        x = 'foo'
+        if x != 'foo'
+            y = 'a'
+        endif
+        )EOF");
+    number(irlist);
+
+    ASSERT_TRUE(MIR::Passes::sccp(&irlist));
+    ASSERT_FALSE(get_condition(irlist));
+}
+
+TEST(sccp, unary_not) {
+    auto irlist = lower(R"EOF(
+        x = true
+        if not x
+            y = 'a'
+        endif
+        )EOF");
+    number(irlist);
+
+    ASSERT_TRUE(MIR::Passes::sccp(&irlist));
+    ASSERT_FALSE(get_condition(irlist));
+}
+
+TEST(sccp, version_compare) {
+    auto irlist = lower(R"EOF(
+        x = '1.2.3'
+        y = x.version_compare('>= 1.0')
+        )EOF");
+    number(irlist);
+
+    ASSERT_TRUE(MIR::Passes::sccp(&irlist));
+    ASSERT_EQ(irlist.instructions.size(), 2);
+
+    const auto & obj = irlist.instructions.back();
+    ASSERT_TRUE(std::holds_alternative<std::shared_ptr<MIR::Boolean>>(obj));
+    const auto & b = std::get<std::shared_ptr<MIR::Boolean>>(obj);
+    ASSERT_TRUE(b->value);
+    ASSERT_EQ(b->var.name, "y");
+}
+
+TEST(sccp, unreachable_arm) {
+    auto irlist = lower(R"EOF(
+        if false
+            x = 1
+        else
+            x = 2
+        endif
+        if x == 2
+            y = 'a'
+        endif
+        )EOF");
+    number(irlist, true);
+
+    ASSERT_TRUE(MIR::Passes::sccp(&irlist));
+    ASSERT_FALSE(get_condition(irlist));
+
+    // The value of x is only the live side of the phi
+    const auto & fin = get_bb(get_con(irlist.next)->if_false->next);
+    ASSERT_TRUE(get_condition(*fin));
+}
+
+TEST(sccp, shadowed_by_taken_arm) {
+    auto irlist = lower(R"EOF(
+        x = 1
+        if true
+            x = 2
+        endif
+        if x == 2
+            y = 'a'
+        endif
+        )EOF");
+    number(irlist, true);
+
+    ASSERT_TRUE(MIR::Passes::sccp(&irlist));
+    ASSERT_TRUE(get_condition(irlist));
+
+    // The first x still dominates the join, but the second one shadows it on
+    // the only executable edge
+    const auto & fin = get_con(irlist.next)->if_false;
+    ASSERT_TRUE(get_condition(*fin));
+}
+
+TEST(sccp, unknown) {
+    auto irlist = lower(R"EOF(
+        if x == 2
+            y = 'a'
+        endif
+        )EOF");
+    number(irlist);
+
+    ASSERT_FALSE(MIR::Passes::sccp(&irlist));
+    ASSERT_TRUE(std::holds_alternative<std::shared_ptr<MIR::FunctionCall>>(
+        get_con(irlist.next)->condition));
+}
@@ -135,10 +135,8 @@ TEST(number_uses, with_phi) {
     // Do this in two passes as otherwise the phi won't get inserted, and thus y will point at the
     // wrong thing
     MIR::Passes::block_walker(
-        &irlist, {
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, data); },
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::insert_phis(b, data); },
-                 });
+        &irlist, {[&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, data); }});
+    MIR::Passes::insert_phis(&irlist, data);
     MIR::Passes::block_walker(
         &irlist, {
                      MIR::Passes::branch_pruning,
@@ -183,10 +181,11 @@ TEST(number_uses, with_phi_no_pruning_in_func_call) {
 
     // Do this in two passes as otherwise the phi won't get inserted, and thus y will point at the
     // wrong thing
+    MIR::Passes::block_walker(
+        &irlist, {[&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, data); }});
+    MIR::Passes::insert_phis(&irlist, data);
     MIR::Passes::block_walker(
         &irlist, {
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, data); },
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::insert_phis(b, data); },
                      [&](MIR::BasicBlock * b) { return MIR::Passes::usage_numbering(b, rt); },
                  });
 
@@ -225,10 +224,11 @@ TEST(number_uses, with_phi_no_pruning) {
 
     // Do this in two passes as otherwise the phi won't get inserted, and thus y will point at the
     // wrong thing
+    MIR::Passes::block_walker(
+        &irlist, {[&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, data); }});
+    MIR::Passes::insert_phis(&irlist, data);
     MIR::Passes::block_walker(
         &irlist, {
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::value_numbering(b, data); },
-                     [&](MIR::BasicBlock * b) { return MIR::Passes::insert_phis(b, data); },
                      [&](MIR::BasicBlock * b) { return MIR::Passes::usage_numbering(b, rt); },
                  });
 
@@ -1,11 +1,13 @@
 // SPDX-license-identifier: Apache-2.0
 // Copyright © 2021 Dylan Baker
 
+#include <atomic>
 #include <deque>
 #include <set>
 
 #include "exceptions.hpp"
 #include "private.hpp"
+#include "thread_pool.hpp"
 
 namespace MIR::Passes {
 
@@ -164,6 +166,8 @@ bool function_walker(BasicBlock * block, const ReplacementCallback & cb) {
     // Check if we have a condition, and try to lower that as well.
     if (std::holds_alternative<std::unique_ptr<Condition>>(block->next)) {
         auto & con = std::get<std::unique_ptr<Condition>>(block->next);
+        progress |= array_walker(con->condition, cb);
+        progress |= function_argument_walker(con->condition, cb);
         auto new_value = cb(con->condition);
         if (new_value.has_value()) {
             con->condition = std::move(new_value.value());
@@ -189,6 +193,8 @@ bool function_walker(BasicBlock * block, const MutationCallback & cb) {
     // Check if we have a condition, and try to lower that as well.
     if (std::holds_alternative<std::unique_ptr<Condition>>(block->next)) {
         auto & con = std::get<std::unique_ptr<Condition>>(block->next);
+        progress |= array_walker(con->condition, cb);
+        progress |= function_argument_walker(con->condition, cb);
         progress |= cb(con->condition);
     }
 
@@ -238,4 +244,77 @@ bool block_walker(BasicBlock * root, const std::vector<BlockWalkerCb> & callback
     return progress;
 }
 
+bool parallel_block_walker(BasicBlock * root, const std::vector<BlockWalkerCb> & callbacks) {
+    // Gather each block once, in the same order as the block_walker would
+    std::vector<BasicBlock *> blocks{};
+    {
+        std::set<BasicBlock *> seen{};
+        std::deque<BasicBlock *> todo{root};
+        while (!todo.empty()) {
+            BasicBlock * current = todo.back();
+            todo.pop_back();
+            if (!seen.emplace(current).second) {
+                continue;
+            }
+            blocks.emplace_back(current);
+
+            if (std::holds_alternative<std::unique_ptr<Condition>>(current->next)) {
+                const auto & con = std::get<std::unique_ptr<Condition>>(current->next);
+                if (con->if_false != nullptr) {
+                    todo.push_front(con->if_false.get());
+                }
+                if (con->if_true != nullptr) {
+                    todo.push_front(con->if_true.get());
+                }
+            } else if (std::holds_alternative<std::shared_ptr<BasicBlock>>(current->next)) {
+                auto bb = std::get<std::shared_ptr<BasicBlock>>(current->next);
+                if (bb != nullptr) {
+                    todo.push_front(bb.get());
+                }
+            }
+        }
+    }
+
+    std::atomic_size_t next{0};
+    std::atomic_bool progress{false};
+    std::vector<std::exception_ptr> errors(blocks.size());
+
+    const auto worker = [&]() {
+        for (std::size_t i = next++; i < blocks.size(); i = next++) {
+            try {
+                bool p = false;
+                for (const auto & cb : callbacks) {
+                    p |= cb(blocks[i]);
+                }
+                if (p) {
+                    progress = true;
+                }
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+
+    auto & pool = Util::pool();
+    const std::size_t jobs = std::min(pool.size(), blocks.size());
+    std::vector<std::future<void>> futures{};
+    for (std::size_t i = 1; i < jobs; ++i) {
+        futures.emplace_back(pool.submit(worker));
+    }
+    worker();
+    for (auto & f : futures) {
+        pool.wait(f);
+    }
+
+    // Report the error from the first block, so that the error is the same
+    // one the serial walker would have given.
+    for (const auto & e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+
+    return progress;
+}
+
 } // namespace MIR::Passes
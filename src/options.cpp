@@ -1,6 +1,7 @@
 // SPDX-license-identifier: Apache-2.0
 // Copyright © 2021 Dylan Baker
 
+#include <cstdlib>
 #include <iostream>
 
 #include "getopt.h" // XXX: This is probably not permanent
@@ -38,6 +39,9 @@ Verbs:
                 The source directory to configure, defaults to '.'
             -D, --define
                 Set a Meson built-in or project option
+            -j, --jobs
+                The number of threads to use while configuring, defaults to
+                the number of hardware threads
 
 )EOF";
 // clang-format on
@@ -60,11 +64,12 @@ Verb get_verb(int & argc, const char * const argv[]) {
 ConfigureOptions get_config_options(int argc, char * argv[]) {
     ConfigureOptions conf{};
 
-    static const char * const short_opts = "hs:D:";
+    static const char * const short_opts = "hs:D:j:";
     static const option long_opts[] = {
         {"help", no_argument, NULL, 'h'},
         {"source-dir", required_argument, NULL, 's'},
         {"define", required_argument, NULL, 'D'},
+        {"jobs", required_argument, NULL, 'j'},
         {NULL},
     };
 
@@ -92,6 +97,17 @@ ConfigureOptions get_config_options(int argc, char * argv[]) {
                 conf.options[opt] = value;
                 break;
             }
+            case 'j': {
+                char * end = nullptr;
+                const long j = std::strtol(optarg, &end, 10);
+                if (*end != '\0' || j < 1) {
+                    std::cerr << "jobs must be a positive integer, got \"" << optarg << "\"."
+                              << std::endl;
+                    exit(1);
+                }
+                conf.jobs = static_cast<std::size_t>(j);
+                break;
+            }
             case 'h':
             default:
                 std::cout << usage << std::endl;
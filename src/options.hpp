@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <filesystem>
 #include <string>
 #include <unordered_map>
@@ -31,6 +32,8 @@ struct ConfigureOptions {
     fs::path builddir;
     fs::path sourcedir;
     std::unordered_map<std::string, std::string> options;
+    /// Number of threads to use, 0 means the number of hardware threads
+    std::size_t jobs = 0;
 };
 
 /**
@@ -28,4 +28,12 @@ class InvalidArguments : public MesonException {
     using MesonException::MesonException;
 };
 
+/**
+ * Exception for an external process that ran longer than it was allowed to
+ */
+class ProcessTimeout : public MesonException {
+  public:
+    using MesonException::MesonException;
+};
+
 } // namespace Util::Exceptions
@@ -0,0 +1,84 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "path_index.hpp"
+
+namespace Util {
+
+namespace fs = std::filesystem;
+
+PathIndex::PathIndex(const std::string & path) : dirs{split_path(path)} {
+    for (std::size_t i = 0; i < dirs.size(); ++i) {
+        DIR * d = opendir(dirs[i].c_str());
+        if (d == nullptr) {
+            continue;
+        }
+        while (const dirent * e = readdir(d)) {
+            // Directories can't be programs, anything else (including
+            // symlinks and unknown types) is checked when it's looked up
+            if (e->d_type == DT_DIR) {
+                continue;
+            }
+            auto & where = entries[e->d_name];
+            // The same directory may be in PATH more than once
+            if (where.empty() || where.back() != i) {
+                where.emplace_back(i);
+            }
+        }
+        closedir(d);
+    }
+}
+
+fs::path PathIndex::find(const std::string & name) const {
+    if (name.find('/') != std::string::npos) {
+        return is_executable(name) ? fs::path{name} : fs::path{};
+    }
+
+    if (const auto & i = find_directory(name)) {
+        return dirs[i.value()] / name;
+    }
+    return {};
+}
+
+std::optional<std::size_t> PathIndex::find_directory(const std::string & name) const {
+    const auto & it = entries.find(name);
+    if (it == entries.end()) {
+        return std::nullopt;
+    }
+    for (const auto & i : it->second) {
+        if (is_executable(dirs[i] / name)) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+const std::vector<fs::path> & PathIndex::directories() const { return dirs; }
+
+std::vector<fs::path> split_path(const std::string & path) {
+    std::vector<fs::path> dirs{};
+    std::string::size_type last = 0;
+    while (true) {
+        const auto next = path.find(':', last);
+        const std::string dir = path.substr(last, next - last);
+        dirs.emplace_back(dir.empty() ? "." : dir);
+        if (next == std::string::npos) {
+            break;
+        }
+        last = next + 1;
+    }
+    return dirs;
+}
+
+bool is_executable(const fs::path & path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return false;
+    }
+    return S_ISREG(st.st_mode) && (st.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH)) != 0;
+}
+
+} // namespace Util
@@ -0,0 +1,62 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+/**
+ * An index of the programs in PATH
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Util {
+
+/**
+ * An in memory index of the entries in each PATH directory
+ *
+ * Each directory is read once, when the index is built, so that looking up a
+ * program is a hash lookup and a single stat, instead of a stat for every
+ * directory in PATH.
+ */
+class PathIndex {
+  public:
+    /// Index the directories of a `:` separated PATH string
+    explicit PathIndex(const std::string & path);
+
+    /**
+     * Find the first executable with this name
+     *
+     * Names with a directory separator are checked directly rather than being
+     * looked up. Returns an empty path if no executable is found.
+     */
+    std::filesystem::path find(const std::string & name) const;
+
+    /**
+     * Find the index of the first directory with an executable of this name
+     *
+     * Unlike `find()` this doesn't handle names with a directory separator.
+     */
+    std::optional<std::size_t> find_directory(const std::string & name) const;
+
+    /// The directories in PATH, in search order
+    const std::vector<std::filesystem::path> & directories() const;
+
+  private:
+    std::vector<std::filesystem::path> dirs;
+
+    /// name : indexes into dirs of every directory with an entry of that name
+    std::unordered_map<std::string, std::vector<std::size_t>> entries;
+};
+
+/// Split a `:` separated PATH string, empty elements are the current directory
+std::vector<std::filesystem::path> split_path(const std::string & path);
+
+/// Is this path an executable regular file (following symlinks)?
+bool is_executable(const std::filesystem::path &);
+
+} // namespace Util
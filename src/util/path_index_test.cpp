@@ -0,0 +1,73 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "path_index.hpp"
+#include "test_directory.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+class PathIndexTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        fs::create_directories(root / "a");
+        fs::create_directories(root / "b");
+    }
+
+    void touch(const fs::path & p, bool exe) {
+        std::ofstream{p} << "#!/bin/sh\n";
+        fs::permissions(p, exe ? fs::perms::owner_all
+                               : fs::perms::owner_read | fs::perms::owner_write);
+    }
+
+    std::string path() const { return (root / "a").string() + ":" + (root / "b").string(); }
+
+    const Util::TestDirectory tmp{};
+    const fs::path & root = tmp.path;
+};
+
+} // namespace
+
+TEST_F(PathIndexTest, first_directory_wins) {
+    touch(root / "a" / "prog", true);
+    touch(root / "b" / "prog", true);
+    Util::PathIndex index{path()};
+    ASSERT_EQ(index.find("prog"), root / "a" / "prog");
+}
+
+TEST_F(PathIndexTest, last_directory) {
+    touch(root / "b" / "prog", true);
+    Util::PathIndex index{path()};
+    ASSERT_EQ(index.find("prog"), root / "b" / "prog");
+}
+
+TEST_F(PathIndexTest, not_executable) {
+    touch(root / "a" / "prog", false);
+    touch(root / "b" / "prog", true);
+    Util::PathIndex index{path()};
+    ASSERT_EQ(index.find("prog"), root / "b" / "prog");
+}
+
+TEST_F(PathIndexTest, directory_is_not_a_program) {
+    fs::create_directories(root / "a" / "prog");
+    Util::PathIndex index{path()};
+    ASSERT_EQ(index.find("prog"), fs::path{});
+}
+
+TEST_F(PathIndexTest, missing) {
+    Util::PathIndex index{path() + ":" + (root / "does-not-exist").string()};
+    ASSERT_EQ(index.find("prog"), fs::path{});
+    ASSERT_EQ(index.directories().size(), 3);
+}
+
+TEST_F(PathIndexTest, absolute) {
+    touch(root / "prog", true);
+    Util::PathIndex index{path()};
+    ASSERT_EQ(index.find((root / "prog").string()), root / "prog");
+}
@@ -1,117 +1,327 @@
 // SPDX-license-identifier: Apache-2.0
 // Copyright © 2021 Intel Corporation
 
-#include <array>
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
 #include <iostream>
-#include <thread>
+#include <limits>
 
 // TODO: a windows version of this.
-#include <poll.h>
-#include <sys/types.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include "exceptions.hpp"
 #include "process.hpp"
+#include "thread_pool.hpp"
+
+extern char ** environ;
 
 namespace Util {
 
 #define READ 0
 #define WRITE 1
 
-namespace {}
+namespace {
+
+/// The epoll key of the eventfd, job keys are (id << 1 | stream)
+constexpr std::uint64_t WAKE_KEY = std::numeric_limits<std::uint64_t>::max();
+
+void close_pipe(int fds[2]) {
+    close(fds[READ]);
+    close(fds[WRITE]);
+}
+
+std::string join(const std::vector<std::string> & cmd) {
+    std::string out{};
+    for (const auto & c : cmd) {
+        if (!out.empty()) {
+            out.append(" ");
+        }
+        out.append(c);
+    }
+    return out;
+}
+
+int decode_status(int status) {
+    int code = 0;
+    if (WIFEXITED(status)) {
+        code = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        code = 128 + WTERMSIG(status);
+    }
+
+    // On Unix-like OSes return codes > 128 are traditionally used for
+    // returning error codes, 128 + n, where n is the code.
+    if (code > 128) {
+        code -= 128;
+        code *= -1;
+    }
+
+    return code;
+}
+
+} // namespace
+
+ProcessGroup::ProcessGroup(std::size_t max_jobs_)
+    : max_jobs{std::max<std::size_t>(max_jobs_, 1)}, epoll_fd{epoll_create1(EPOLL_CLOEXEC)},
+      wake_fd{eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)} {
+    if (epoll_fd < 0 || wake_fd < 0) {
+        throw Exceptions::MesonException{"Could not create the process event loop: " +
+                                         std::string{strerror(errno)}};
+    }
 
-Result process(const std::vector<std::string> & cmd) {
-    std::string out{}, err{};
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = WAKE_KEY;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+
+    thread = std::thread{&ProcessGroup::loop, this};
+}
+
+ProcessGroup::~ProcessGroup() {
+    {
+        std::lock_guard l{lock};
+        done = true;
+    }
+    const std::uint64_t one = 1;
+    [[maybe_unused]] auto _ = write(wake_fd, &one, sizeof(one));
+    thread.join();
+
+    close(wake_fd);
+    close(epoll_fd);
+}
+
+std::future<Result> ProcessGroup::submit(std::vector<std::string> cmd,
+                                         std::chrono::milliseconds timeout) {
+    Job job{std::move(cmd), timeout, {}};
+    auto future = job.result.get_future();
+    {
+        std::lock_guard l{lock};
+        pending.emplace_back(std::move(job));
+    }
+    const std::uint64_t one = 1;
+    [[maybe_unused]] auto _ = write(wake_fd, &one, sizeof(one));
+    return future;
+}
+
+void ProcessGroup::start(Job && job) {
+    // Build the argument list up front, so that nothing needs to be allocated
+    // or copied once the child exists
+    std::vector<char *> argv{};
+    argv.reserve(job.cmd.size() + 1);
+    for (const auto & c : job.cmd) {
+        argv.emplace_back(const_cast<char *>(c.c_str()));
+    }
+    argv.emplace_back(nullptr);
+
+    // The pipes are close-on-exec so that other children don't inherit them,
+    // and hold them open after this child has exited
     int out_pipes[2];
     int err_pipes[2];
-    if (pipe(out_pipes) != 0) {
-        // Do something reall
-        throw std::exception{};
+    if (pipe2(out_pipes, O_CLOEXEC) != 0) {
+        job.result.set_exception(std::make_exception_ptr(Exceptions::MesonException{
+            "Could not create a pipe: " + std::string{strerror(errno)}}));
+        return;
     }
-    if (pipe(err_pipes) != 0) {
-        // Do something reall
-        throw std::exception{};
+    if (pipe2(err_pipes, O_CLOEXEC) != 0) {
+        close_pipe(out_pipes);
+        job.result.set_exception(std::make_exception_ptr(Exceptions::MesonException{
+            "Could not create a pipe: " + std::string{strerror(errno)}}));
+        return;
     }
 
-    pid_t pid = fork();
-    if (pid == 0) {
-        dup2(out_pipes[WRITE], STDOUT_FILENO);
-        dup2(err_pipes[WRITE], STDERR_FILENO);
+    // dup2 clears close-on-exec on the new descriptors, so only stdout and
+    // stderr are passed to the child
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, out_pipes[WRITE], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, err_pipes[WRITE], STDERR_FILENO);
+
+    // posix_spawn doesn't copy the page tables of this process, unlike fork,
+    // so it doesn't get slower as the amount of memory we're using grows
+    pid_t pid;
+    const int spawned = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+
+    close(out_pipes[WRITE]);
+    close(err_pipes[WRITE]);
+
+    if (spawned != 0) {
         close(out_pipes[READ]);
-        close(out_pipes[WRITE]);
         close(err_pipes[READ]);
-        close(err_pipes[WRITE]);
+        job.result.set_value(
+            Result{127, "", "Program failed to execute: " + std::string{strerror(spawned)}});
+        return;
+    }
 
-        char * c_cmd[cmd.size() + 1];
-        for (unsigned i = 0; i < cmd.size(); ++i) {
-            c_cmd[i] = strdup(cmd[i].c_str());
-        }
-        c_cmd[cmd.size()] = NULL;
+    const std::uint64_t id = next_id++;
+    Running & r = running[id];
+    r.result = std::move(job.result);
+    r.command = join(job.cmd);
+    r.pid = pid;
+    r.fds = {out_pipes[READ], err_pipes[READ]};
+    r.deadline = std::chrono::steady_clock::now() + job.timeout;
 
-        execvp(c_cmd[0], c_cmd);
-        std::cerr << "Program failed to execute: " << strerror(errno) << std::endl;
-        _exit(127);
+    // Only our ends are non-blocking, the child gets ordinary pipes
+    for (std::uint64_t i = 0; i < r.fds.size(); ++i) {
+        fcntl(r.fds[i], F_SETFL, fcntl(r.fds[i], F_GETFL) | O_NONBLOCK);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = id << 1 | i;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, r.fds[i], &ev);
     }
+}
 
-    close(out_pipes[WRITE]);
-    close(err_pipes[WRITE]);
-
-    std::array<char, 16384> buffer{};
-    int status;
-    int count = 0;
+void ProcessGroup::close_fds(Running & r) {
+    for (auto & fd : r.fds) {
+        if (fd >= 0) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+            close(fd);
+            fd = -1;
+        }
+    }
+}
 
-    std::array<pollfd, 2> fds;
-    fds[0] = {out_pipes[READ], POLLIN, 0};
-    fds[1] = {err_pipes[READ], POLLIN, 0};
+void ProcessGroup::read(std::uint64_t key) {
+    // An event may still be queued for a job that finished earlier in the
+    // same batch
+    auto it = running.find(key >> 1);
+    if (it == running.end()) {
+        return;
+    }
+    Running & r = it->second;
+    const std::size_t stream = key & 1;
+    int & fd = r.fds[stream];
+    if (fd < 0) {
+        return;
+    }
 
+    std::array<char, 16384> buffer;
     while (true) {
-        int rt = poll(fds.data(), fds.size(), 5 * 1000);
+        const ssize_t count = ::read(fd, buffer.data(), buffer.size());
+        if (count > 0) {
+            r.output[stream].append(buffer.begin(), buffer.begin() + count);
+        } else if (count < 0 && errno == EINTR) {
+            continue;
+        } else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        } else {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+            close(fd);
+            fd = -1;
+            return;
+        }
+    }
+}
 
-        if (rt < 0) {
-            std::cerr << "Error: " << strerror(errno) << std::endl;
-        } else if (rt == 0) {
-            kill(pid, SIGKILL);
-            for (auto const & f : fds) {
-                close(f.fd);
+bool ProcessGroup::reap() {
+    const auto now = std::chrono::steady_clock::now();
+    bool waiting = false;
+
+    for (auto it = running.begin(); it != running.end();) {
+        Running & r = it->second;
+
+        if (r.fds[0] < 0 && r.fds[1] < 0) {
+            // Both pipes being closed usually means that the child has exited,
+            // but it may have closed them itself and still be running
+            int status;
+            pid_t ret;
+            while ((ret = waitpid(r.pid, &status, WNOHANG)) == -1 && errno == EINTR)
+                ;
+            if (ret == r.pid) {
+                r.result.set_value(Result{decode_status(status), std::move(r.output[0]),
+                                          std::move(r.output[1])});
+                it = running.erase(it);
+                continue;
             }
-            // XXX: do something less silly here.
-            throw std::exception{};
+            waiting = true;
         }
 
-        if (fds[0].revents & POLLIN) {
-            count = read(out_pipes[READ], buffer.data(), buffer.size());
-            out.append(buffer.begin(), buffer.begin() + count);
+        if (now >= r.deadline) {
+            kill(r.pid, SIGKILL);
+            close_fds(r);
+            while (waitpid(r.pid, nullptr, 0) == -1 && errno == EINTR)
+                ;
+            r.result.set_exception(std::make_exception_ptr(
+                Exceptions::ProcessTimeout{"Process timed out: " + r.command}));
+            it = running.erase(it);
+            continue;
         }
-        if (fds[1].revents & POLLIN) {
-            count = read(err_pipes[READ], buffer.data(), buffer.size());
-            err.append(buffer.begin(), buffer.begin() + count);
+
+        ++it;
+    }
+
+    return waiting;
+}
+
+void ProcessGroup::loop() {
+    std::array<epoll_event, 64> events;
+    bool waiting = false;
+
+    while (true) {
+        {
+            std::unique_lock l{lock};
+            while (running.size() < max_jobs && !pending.empty()) {
+                Job job = std::move(pending.front());
+                pending.pop_front();
+                l.unlock();
+                start(std::move(job));
+                l.lock();
+            }
+            if (done && pending.empty() && running.empty()) {
+                return;
+            }
         }
 
-        if (fds[0].revents & POLLHUP and fds[1].revents & POLLHUP) {
-            break;
+        // Sleep until the nearest deadline, or poll for children that closed
+        // their pipes but haven't exited yet
+        int timeout = -1;
+        const auto now = std::chrono::steady_clock::now();
+        for (const auto & [_, r] : running) {
+            const auto left =
+                std::chrono::duration_cast<std::chrono::milliseconds>(r.deadline - now).count();
+            const int ms = static_cast<int>(std::clamp<decltype(left)>(
+                left + 1, 0, std::numeric_limits<int>::max()));
+            timeout = timeout < 0 ? ms : std::min(timeout, ms);
+        }
+        if (waiting) {
+            timeout = timeout < 0 ? 10 : std::min(timeout, 10);
         }
-    }
 
-    for (auto const & f : fds) {
-        close(f.fd);
-    }
+        const int count = epoll_wait(epoll_fd, events.data(), events.size(), timeout);
+        if (count < 0 && errno != EINTR) {
+            std::cerr << "Error: " << strerror(errno) << std::endl;
+        }
 
-    while (waitpid(pid, &status, 0) == -1)
-        ;
+        for (int i = 0; i < count; ++i) {
+            const std::uint64_t key = events[i].data.u64;
+            if (key == WAKE_KEY) {
+                std::uint64_t value;
+                [[maybe_unused]] auto _ = ::read(wake_fd, &value, sizeof(value));
+            } else {
+                read(key);
+            }
+        }
 
-    if (status > 255) {
-        status %= 255;
+        waiting = reap();
     }
+}
 
-    // On Unix-like OSes return codes > 128 are traditionally used for
-    // returning error codes, 128 + n, where n is the code.
-    if (status > 128) {
-        status -= 128;
-        status *= -1;
-    }
+ProcessGroup & processes() {
+    // This is never destroyed. Pool workers may still be waiting on processes
+    // while the pool is being torn down at exit, so the group must outlive it.
+    static ProcessGroup * group = new ProcessGroup{pool().size()};
+    return *group;
+}
 
-    return Result{status, out, err};
+Result process(const std::vector<std::string> & cmd, std::chrono::milliseconds timeout) {
+    return processes().submit(cmd, timeout).get();
 };
 
 } // namespace Util
@@ -7,11 +7,20 @@
 
 #pragma once
 
+#include <array>
+#include <chrono>
 #include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
+#include <sys/types.h>
+
 namespace Util {
 
 /**
@@ -21,12 +30,95 @@ namespace Util {
  */
 typedef std::tuple<int8_t, std::string, std::string> Result;
 
+/// How long a process may run for if no other timeout is given
+constexpr std::chrono::milliseconds DEFAULT_TIMEOUT = std::chrono::minutes{1};
+
+/**
+ * A group of external processes, run concurrently
+ *
+ * All of the children's stdout and stderr pipes are read by a single thread,
+ * through one epoll loop, instead of a thread (or a blocked caller) per child.
+ * At most `max_jobs` children are running at once, the rest wait in a queue
+ * and are started in the order they were submitted as running children exit.
+ *
+ * A child that runs longer than it's timeout is killed, and the future for it
+ * holds a `Exceptions::ProcessTimeout`. A program that cannot be started is
+ * not an error, the result has a return code of 127, like a shell.
+ */
+class ProcessGroup {
+  public:
+    /// Create a group that runs at most max_jobs children at once, at least one
+    explicit ProcessGroup(std::size_t max_jobs);
+
+    /// Waits for every submitted process to finish
+    ~ProcessGroup();
+
+    ProcessGroup(const ProcessGroup &) = delete;
+    ProcessGroup & operator=(const ProcessGroup &) = delete;
+
+    /// Submit a command to be run, returns a future with the result
+    std::future<Result> submit(std::vector<std::string> cmd,
+                               std::chrono::milliseconds timeout = DEFAULT_TIMEOUT);
+
+  private:
+    struct Job {
+        std::vector<std::string> cmd;
+        std::chrono::milliseconds timeout;
+        std::promise<Result> result;
+    };
+
+    struct Running {
+        std::promise<Result> result;
+        std::string command;
+        pid_t pid;
+
+        /// The read ends of the stdout and stderr pipes, -1 once closed
+        std::array<int, 2> fds;
+        std::array<std::string, 2> output;
+
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    void loop();
+    void start(Job && job);
+    void read(std::uint64_t key);
+    void close_fds(Running & running);
+    bool reap();
+
+    const std::size_t max_jobs;
+
+    int epoll_fd;
+
+    /// An eventfd used to wake the loop for new jobs, or to exit
+    int wake_fd;
+
+    /// Protects pending and done
+    std::mutex lock;
+    std::deque<Job> pending;
+    bool done = false;
+
+    /// Only touched by the loop thread
+    std::unordered_map<std::uint64_t, Running> running;
+    std::uint64_t next_id = 0;
+
+    std::thread thread;
+};
+
+/**
+ * Get the process wide process group
+ *
+ * It is created the first time this is called, with the same number of jobs as
+ * the thread pool.
+ */
+ProcessGroup & processes();
+
 /**
- * Run an external process in a thread, and return the output, stdout, and stderr
+ * Run an external process and wait for it, returning the output, stdout, and stderr
  *
- * Can be configured to not return stdout and stderr, in which case it will
- * just surpress them
+ * The process is run by the process wide group, so it counts against the
+ * limit on how many children may run at once.
  */
-Result process(const std::vector<std::string> &);
+Result process(const std::vector<std::string> &,
+               std::chrono::milliseconds timeout = DEFAULT_TIMEOUT);
 
 }; // namespace Util
@@ -0,0 +1,95 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+/**
+ * Measure how many processes can be spawned per second as the memory used by
+ * the parent grows, both with Util::process and with fork() for comparison.
+ *
+ * usage: process_bench [iterations] [ballast in MiB...]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "process.hpp"
+
+namespace {
+
+/// The simplest fork and exec, how Util::process used to start children
+void fork_exec() {
+    const pid_t pid = fork();
+    if (pid == 0) {
+        execlp("true", "true", nullptr);
+        _exit(127);
+    }
+    waitpid(pid, nullptr, 0);
+}
+
+/// The resident set size of this process in MiB, as reported by the kernel
+std::size_t resident_mib() {
+    std::ifstream in{"/proc/self/status"};
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.rfind("VmRSS:", 0) == 0) {
+            // The value is in kB
+            return std::stoul(line.substr(6)) / 1024;
+        }
+    }
+    return 0;
+}
+
+template <typename F> double spawns_per_second(unsigned iterations, F && func) {
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations; ++i) {
+        func();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return iterations / elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char * argv[]) {
+    const unsigned iterations = argc > 1 ? std::stoul(argv[1]) : 500;
+    std::vector<std::size_t> sizes{0, 256, 1024};
+    if (argc > 2) {
+        sizes.clear();
+        for (int i = 2; i < argc; ++i) {
+            sizes.emplace_back(std::stoul(argv[i]));
+        }
+    }
+
+    const std::vector<std::string> cmd{"true"};
+    std::cout << "ballast (MiB)\tVmRSS (MiB)\tUtil::process (spawns/s)\tfork (spawns/s)"
+              << std::endl;
+    for (const auto & size : sizes) {
+        // Touch every page, so that it is really part of the resident set
+        const std::size_t bytes = size * 1024 * 1024;
+        char * ballast = static_cast<char *>(std::malloc(bytes));
+        if (bytes != 0 && ballast == nullptr) {
+            std::cerr << "Could not allocate " << size << " MiB" << std::endl;
+            return 1;
+        }
+        std::memset(ballast, 1, bytes);
+        // The ballast is never read, make sure the compiler can't drop the
+        // allocation or the writes to it
+        asm volatile("" : : "r"(ballast) : "memory");
+
+        const double spawned = spawns_per_second(iterations, [&]() { Util::process(cmd); });
+        const double forked = spawns_per_second(iterations, fork_exec);
+        std::cout << size << "\t\t" << resident_mib() << "\t\t" << static_cast<unsigned>(spawned)
+                  << "\t\t\t\t" << static_cast<unsigned>(forked) << std::endl;
+
+        std::free(ballast);
+    }
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "exceptions.hpp"
+#include "process.hpp"
+
+TEST(process, output) {
+    const auto & [ret, out, err] = Util::process({"sh", "-c", "echo foo; echo bar >&2"});
+    ASSERT_EQ(ret, 0);
+    ASSERT_EQ(out, "foo\n");
+    ASSERT_EQ(err, "bar\n");
+}
+
+TEST(process, returncode) {
+    const auto & [ret, out, err] = Util::process({"sh", "-c", "exit 3"});
+    ASSERT_EQ(ret, 3);
+}
+
+TEST(process, large_output) {
+    // More than fits in a pipe, on both streams at once
+    const auto & [ret, out, err] =
+        Util::process({"sh", "-c", "head -c 1000000 /dev/zero; head -c 1000000 /dev/zero >&2"});
+    ASSERT_EQ(ret, 0);
+    ASSERT_EQ(out.size(), 1000000);
+    ASSERT_EQ(err.size(), 1000000);
+}
+
+TEST(process, not_found) {
+    const auto & [ret, out, err] = Util::process({"this-program-does-not-exist"});
+    ASSERT_EQ(ret, 127);
+    ASSERT_TRUE(out.empty());
+}
+
+TEST(process, timeout) {
+    ASSERT_THROW(Util::process({"sleep", "10"}, std::chrono::milliseconds{100}),
+                 Util::Exceptions::ProcessTimeout);
+}
+
+TEST(process_group, concurrent) {
+    Util::ProcessGroup group{4};
+    std::vector<std::future<Util::Result>> results{};
+    for (int i = 0; i < 16; ++i) {
+        results.emplace_back(group.submit({"sh", "-c", "echo " + std::to_string(i)}));
+    }
+    for (int i = 0; i < 16; ++i) {
+        const auto & [ret, out, err] = results[i].get();
+        ASSERT_EQ(ret, 0);
+        ASSERT_EQ(out, std::to_string(i) + "\n");
+    }
+}
+
+TEST(process_group, limit) {
+    // With one job at a time the second sleep can't start until the first
+    // finishes, so together they take longer than the timeout of either
+    Util::ProcessGroup group{1};
+    auto first = group.submit({"sleep", "0.3"}, std::chrono::milliseconds{1000});
+    auto second = group.submit({"sleep", "0.3"}, std::chrono::milliseconds{1000});
+    const auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(std::get<0>(first.get()), 0);
+    ASSERT_EQ(std::get<0>(second.get()), 0);
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds{600});
+}
+
+TEST(process_group, timeout_only_affects_job) {
+    Util::ProcessGroup group{2};
+    auto slow = group.submit({"sleep", "10"}, std::chrono::milliseconds{100});
+    auto fast = group.submit({"sh", "-c", "echo ok"});
+    ASSERT_THROW(slow.get(), Util::Exceptions::ProcessTimeout);
+    ASSERT_EQ(std::get<1>(fast.get()), "ok\n");
+}
@@ -0,0 +1,194 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <fstream>
+#include <sstream>
+
+#include <sys/stat.h>
+
+#include "program_cache.hpp"
+
+namespace Util {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const std::string CACHE_HEADER = "meson++ program cache 1";
+
+/// Tabs and newlines are used as separators in the cache file
+bool serializable(const std::string & s) {
+    return s.find_first_of("\t\n") == std::string::npos;
+}
+
+} // namespace
+
+bool ProgramCache::Stamp::operator==(const Stamp & o) const {
+    return dev == o.dev && ino == o.ino && mtime == o.mtime;
+}
+
+ProgramCache::ProgramCache(const std::string & p) : path{p}, dirs{split_path(p)} {}
+
+ProgramCache::Stamp ProgramCache::stamp(const fs::path & p) {
+    struct stat st;
+    if (stat(p.c_str(), &st) != 0) {
+        return {};
+    }
+    return {static_cast<std::uint64_t>(st.st_dev), static_cast<std::uint64_t>(st.st_ino),
+            static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec};
+}
+
+const std::vector<ProgramCache::Stamp> & ProgramCache::dir_stamps() {
+    // These must be taken before the directories are read, so that a change
+    // made while reading them is seen by the next configuration
+    if (stamps.empty()) {
+        for (const auto & d : dirs) {
+            stamps.emplace_back(stamp(d));
+        }
+    }
+    return stamps;
+}
+
+fs::path ProgramCache::find(const std::string & name) {
+    {
+        std::lock_guard l{lock};
+        dir_stamps();
+        if (auto it = entries.find(name); it != entries.end()) {
+            return it->second.path;
+        }
+    }
+
+    ++miss_count;
+    std::call_once(index_once, [this]() { index = std::make_unique<const PathIndex>(path); });
+
+    Entry entry{};
+    if (name.find('/') != std::string::npos) {
+        entry.path = index->find(name);
+        entry.dir = -1;
+    } else if (const auto & i = index->find_directory(name)) {
+        entry.path = dirs[i.value()] / name;
+        entry.dir = static_cast<std::int64_t>(i.value());
+    } else {
+        entry.dir = static_cast<std::int64_t>(dirs.size());
+    }
+    if (!entry.path.empty()) {
+        entry.stamp = stamp(entry.path);
+    }
+
+    std::lock_guard l{lock};
+    return entries.try_emplace(name, std::move(entry)).first->second.path;
+}
+
+void ProgramCache::load(const fs::path & file) {
+    std::ifstream in{file};
+    if (!in.is_open()) {
+        return;
+    }
+
+    std::string line{};
+    if (!std::getline(in, line) || line != CACHE_HEADER) {
+        return;
+    }
+    if (!std::getline(in, line) || line != path) {
+        return;
+    }
+
+    std::lock_guard l{lock};
+    const auto & current = dir_stamps();
+
+    // Everything found in a directory after the first one that changed may be
+    // shadowed by something new
+    std::size_t first_changed = dirs.size();
+    for (std::size_t i = 0; i < dirs.size(); ++i) {
+        Stamp s{};
+        if (!std::getline(in, line) ||
+            !(std::istringstream{line} >> s.dev >> s.ino >> s.mtime)) {
+            return;
+        }
+        if (first_changed == dirs.size() && !(s == current[i])) {
+            first_changed = i;
+        }
+    }
+
+    while (std::getline(in, line)) {
+        std::istringstream ss{line};
+        std::string name{}, dir{}, p{}, stamp_str{};
+        if (!std::getline(ss, name, '\t') || !std::getline(ss, dir, '\t') ||
+            !std::getline(ss, p, '\t') || !std::getline(ss, stamp_str)) {
+            return;
+        }
+
+        Entry entry{p, 0, {}};
+        if (!(std::istringstream{dir} >> entry.dir) ||
+            !(std::istringstream{stamp_str} >> entry.stamp.dev >> entry.stamp.ino >>
+              entry.stamp.mtime)) {
+            return;
+        }
+
+        bool valid;
+        if (entry.path.empty()) {
+            valid = first_changed == dirs.size();
+        } else if (entry.dir < 0) {
+            valid = entry.stamp == stamp(entry.path);
+        } else {
+            valid = static_cast<std::size_t>(entry.dir) <= first_changed &&
+                    entry.stamp == stamp(entry.path);
+        }
+
+        if (valid) {
+            entries.insert_or_assign(name, std::move(entry));
+        }
+    }
+}
+
+void ProgramCache::save(const fs::path & file) const {
+    {
+        // If nothing was looked up or loaded there's nothing to save
+        std::lock_guard l{lock};
+        if (stamps.size() != dirs.size()) {
+            return;
+        }
+    }
+
+    std::error_code ec{};
+    fs::create_directories(file.parent_path(), ec);
+    if (ec) {
+        return;
+    }
+
+    // Write to a temporary and rename it, so that an interrupted write can't
+    // leave a truncated cache behind
+    const fs::path tmp = fs::path{file}.concat(".tmp");
+    {
+        std::ofstream out{tmp, std::ios::out | std::ios::trunc};
+        if (!out.is_open()) {
+            return;
+        }
+
+        std::lock_guard l{lock};
+        out << CACHE_HEADER << '\n' << path << '\n';
+        for (const auto & s : stamps) {
+            out << s.dev << ' ' << s.ino << ' ' << s.mtime << '\n';
+        }
+        for (const auto & [name, e] : entries) {
+            if (!serializable(name) || !serializable(e.path.string())) {
+                continue;
+            }
+            // A path that didn't exist doesn't depend on PATH, so there's no
+            // cheap way to tell if it exists now
+            if (e.path.empty() && e.dir < 0) {
+                continue;
+            }
+            out << name << '\t' << e.dir << '\t' << e.path.string() << '\t' << e.stamp.dev << ' '
+                << e.stamp.ino << ' ' << e.stamp.mtime << '\n';
+        }
+        if (!out) {
+            return;
+        }
+    }
+    fs::rename(tmp, file, ec);
+}
+
+std::size_t ProgramCache::misses() const { return miss_count; }
+
+} // namespace Util
@@ -0,0 +1,97 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+/**
+ * A cache of program lookups, which persists across configurations
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "path_index.hpp"
+
+namespace Util {
+
+/**
+ * Looks up programs in PATH, remembering the results
+ *
+ * The results can be written to disk, and on the next configuration loaded
+ * again. Loaded results are validated cheaply, without searching PATH:
+ *  - PATH must be the same
+ *  - A program that was found must have the same inode and mtime, and no
+ *    directory in PATH before the one it was found in may have been modified
+ *  - A program that wasn't found requires that no directory in PATH has been
+ *    modified
+ *
+ * Anything that isn't valid is looked up again. PATH is only indexed if
+ * there is a lookup that the cache can't answer.
+ *
+ * Lookups are thread safe.
+ */
+class ProgramCache {
+  public:
+    /// Create an empty cache, for a `:` separated PATH string
+    explicit ProgramCache(const std::string & path);
+
+    /**
+     * Find the first executable with this name
+     *
+     * Returns an empty path if there isn't one.
+     */
+    std::filesystem::path find(const std::string & name);
+
+    /// Load the valid entries from a cache file, if there is one
+    void load(const std::filesystem::path & file);
+
+    /// Write the cache to a file, failing to do so is not an error
+    void save(const std::filesystem::path & file) const;
+
+    /// The number of lookups that couldn't be answered by the cache
+    std::size_t misses() const;
+
+  private:
+    /// Enough about a file to tell if it's changed
+    struct Stamp {
+        std::uint64_t dev = 0;
+        std::uint64_t ino = 0;
+        std::int64_t mtime = -1;
+
+        bool operator==(const Stamp &) const;
+    };
+
+    struct Entry {
+        /// The program, or empty if it wasn't found
+        std::filesystem::path path;
+        /// The index of the PATH directory it was found in, or -1 if the
+        /// name was a path
+        std::int64_t dir;
+        Stamp stamp;
+    };
+
+    static Stamp stamp(const std::filesystem::path &);
+
+    /// Get the stamps of each PATH directory, taken before they're read
+    const std::vector<Stamp> & dir_stamps();
+
+    const std::string path;
+    const std::vector<std::filesystem::path> dirs;
+
+    mutable std::mutex lock;
+    std::unordered_map<std::string, Entry> entries;
+    std::vector<Stamp> stamps;
+
+    std::once_flag index_once;
+    std::unique_ptr<const PathIndex> index;
+
+    std::atomic_size_t miss_count{0};
+};
+
+} // namespace Util
@@ -0,0 +1,128 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "program_cache.hpp"
+#include "test_directory.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+class ProgramCacheTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        fs::create_directories(root / "a");
+        fs::create_directories(root / "b");
+    }
+
+    void touch(const fs::path & p, const std::string & contents = "#!/bin/sh\n") {
+        std::ofstream{p} << contents;
+        fs::permissions(p, fs::perms::owner_all);
+    }
+
+    std::string path() const { return (root / "a").string() + ":" + (root / "b").string(); }
+
+    fs::path cache_file() const { return root / "cache"; }
+
+    /// Do a lookup in one configuration, and save the result
+    void first_run(const std::string & name) {
+        Util::ProgramCache cache{path()};
+        cache.load(cache_file());
+        cache.find(name);
+        cache.save(cache_file());
+    }
+
+    const Util::TestDirectory tmp{};
+    const fs::path & root = tmp.path;
+};
+
+} // namespace
+
+TEST_F(ProgramCacheTest, unchanged) {
+    touch(root / "b" / "prog");
+    first_run("prog");
+    first_run("missing");
+
+    Util::ProgramCache cache{path()};
+    cache.load(cache_file());
+    ASSERT_EQ(cache.find("prog"), root / "b" / "prog");
+    ASSERT_EQ(cache.find("missing"), fs::path{});
+    ASSERT_EQ(cache.misses(), 0);
+}
+
+TEST_F(ProgramCacheTest, not_found_unchanged) {
+    first_run("missing");
+
+    Util::ProgramCache cache{path()};
+    cache.load(cache_file());
+    ASSERT_EQ(cache.find("missing"), fs::path{});
+    ASSERT_EQ(cache.misses(), 0);
+}
+
+TEST_F(ProgramCacheTest, path_changed) {
+    touch(root / "b" / "prog");
+    first_run("prog");
+
+    Util::ProgramCache cache{(root / "b").string()};
+    cache.load(cache_file());
+    ASSERT_EQ(cache.find("prog"), root / "b" / "prog");
+    ASSERT_EQ(cache.misses(), 1);
+}
+
+TEST_F(ProgramCacheTest, shadowed) {
+    touch(root / "b" / "prog");
+    first_run("prog");
+    touch(root / "a" / "prog");
+
+    Util::ProgramCache cache{path()};
+    cache.load(cache_file());
+    ASSERT_EQ(cache.find("prog"), root / "a" / "prog");
+    ASSERT_EQ(cache.misses(), 1);
+}
+
+TEST_F(ProgramCacheTest, later_directory_changed) {
+    touch(root / "a" / "prog");
+    first_run("prog");
+    touch(root / "b" / "other");
+
+    Util::ProgramCache cache{path()};
+    cache.load(cache_file());
+    ASSERT_EQ(cache.find("prog"), root / "a" / "prog");
+    ASSERT_EQ(cache.misses(), 0);
+}
+
+TEST_F(ProgramCacheTest, program_replaced) {
+    touch(root / "a" / "prog");
+    first_run("prog");
+    fs::remove(root / "a" / "prog");
+    touch(root / "b" / "prog");
+
+    Util::ProgramCache cache{path()};
+    cache.load(cache_file());
+    ASSERT_EQ(cache.find("prog"), root / "b" / "prog");
+    ASSERT_EQ(cache.misses(), 1);
+}
+
+TEST_F(ProgramCacheTest, not_found_now_exists) {
+    first_run("prog");
+    touch(root / "b" / "prog");
+
+    Util::ProgramCache cache{path()};
+    cache.load(cache_file());
+    ASSERT_EQ(cache.find("prog"), root / "b" / "prog");
+    ASSERT_EQ(cache.misses(), 1);
+}
+
+TEST_F(ProgramCacheTest, garbage) {
+    std::ofstream{cache_file()} << "not a cache\n";
+
+    Util::ProgramCache cache{path()};
+    cache.load(cache_file());
+    ASSERT_EQ(cache.find("prog"), fs::path{});
+    ASSERT_EQ(cache.misses(), 1);
+}
@@ -0,0 +1,46 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <mutex>
+
+#include "relative_paths.hpp"
+
+namespace Util {
+
+namespace fs = std::filesystem;
+
+fs::path RelativePaths::canonical(const fs::path & path) {
+    {
+        std::shared_lock l{lock};
+        if (auto it = canonicals.find(path.native()); it != canonicals.end()) {
+            return it->second;
+        }
+    }
+
+    // Another thread may resolve the same path at the same time, which is
+    // wasted work, but gives the same answer
+    fs::path resolved = fs::weakly_canonical(path);
+
+    std::unique_lock l{lock};
+    return canonicals.emplace(path.native(), std::move(resolved)).first->second;
+}
+
+std::string RelativePaths::relative(const fs::path & path, const fs::path & base) {
+    std::string key = path.native();
+    key.push_back('\0');
+    key.append(base.native());
+
+    {
+        std::shared_lock l{lock};
+        if (auto it = results.find(key); it != results.end()) {
+            return it->second;
+        }
+    }
+
+    std::string result = canonical(path).lexically_relative(canonical(base)).string();
+
+    std::unique_lock l{lock};
+    return results.emplace(std::move(key), std::move(result)).first->second;
+}
+
+} // namespace Util
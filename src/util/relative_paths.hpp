@@ -0,0 +1,46 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+/**
+ * Memoized relative paths
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Util {
+
+/**
+ * Makes paths relative to a base, remembering the results
+ *
+ * This gives the same results as `std::filesystem::relative`, which is
+ * `weakly_canonical(path).lexically_relative(weakly_canonical(base))`. Only
+ * the canonicalization touches the filesystem, so it's done once for each
+ * unique path and base, and relativizing a pair that has already been seen is
+ * a single lookup. The same include directories are used by many targets, and
+ * the build directory is the base for nearly all of them.
+ *
+ * The filesystem is assumed not to change while this is in use, and lookups
+ * are thread safe.
+ */
+class RelativePaths {
+  public:
+    /// Get path relative to base, like `std::filesystem::relative`
+    std::string relative(const std::filesystem::path & path, const std::filesystem::path & base);
+
+  private:
+    std::filesystem::path canonical(const std::filesystem::path &);
+
+    std::shared_mutex lock;
+
+    /// Relative paths, by path and base separated by a nul
+    std::unordered_map<std::string, std::string> results;
+
+    std::unordered_map<std::string, std::filesystem::path> canonicals;
+};
+
+} // namespace Util
@@ -0,0 +1,66 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+#include "relative_paths.hpp"
+#include "test_directory.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+class RelativePathsTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        fs::create_directories(root / "src" / "include" / "sub");
+        fs::create_directories(root / "build");
+    }
+
+    /// The result has to be exactly what std::filesystem::relative gives
+    void check(const fs::path & path, const fs::path & base) {
+        ASSERT_EQ(paths.relative(path, base), fs::relative(path, base).string());
+        // And the same the second time, from the cache
+        ASSERT_EQ(paths.relative(path, base), fs::relative(path, base).string());
+    }
+
+    Util::RelativePaths paths{};
+    const Util::TestDirectory tmp{};
+    const fs::path & root = tmp.path;
+};
+
+} // namespace
+
+TEST_F(RelativePathsTest, existing) {
+    check(root / "src" / "include", root / "build");
+    check(root / "src" / "include" / "sub", root / "build");
+    check(root / "build", root / "build");
+}
+
+TEST_F(RelativePathsTest, dot_dot) {
+    check(root / "src" / "include" / ".." / "include" / "sub", root / "build");
+}
+
+TEST_F(RelativePathsTest, missing) {
+    check(root / "src" / "missing" / "dir", root / "build");
+}
+
+TEST_F(RelativePathsTest, relative_to_cwd) {
+    check("include", root / "build");
+    check(".", root / "build");
+}
+
+TEST_F(RelativePathsTest, symlink) {
+    // Symlinks are resolved, so this isn't just the lexical answer
+    fs::create_directory_symlink(root / "src" / "include", root / "build" / "link");
+    check(root / "build" / "link" / "sub", root / "build");
+    ASSERT_EQ(paths.relative(root / "build" / "link" / "sub", root / "build"),
+              "../src/include/sub");
+}
+
+TEST_F(RelativePathsTest, different_bases) {
+    check(root / "src" / "include", root / "build");
+    check(root / "src" / "include", root / "src");
+}
@@ -0,0 +1,52 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+/**
+ * A scratch directory for unit tests
+ */
+
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#include <unistd.h>
+
+namespace Util {
+
+/**
+ * A directory for the running test, removed along with everything in it when destroyed
+ *
+ * The name is made from the test's name and the process id, so that tests
+ * running at the same time, or in different processes, don't share one. This
+ * must be created while a test is running, such as in a fixture.
+ */
+class TestDirectory {
+  public:
+    TestDirectory() : path{std::filesystem::temp_directory_path() / name()} {
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+    }
+
+    ~TestDirectory() {
+        std::error_code ec{};
+        std::filesystem::remove_all(path, ec);
+    }
+
+    TestDirectory(const TestDirectory &) = delete;
+    TestDirectory & operator=(const TestDirectory &) = delete;
+
+    const std::filesystem::path path;
+
+  private:
+    static std::string name() {
+        const auto * info = ::testing::UnitTest::GetInstance()->current_test_info();
+        return std::string{"meson++_"} + info->test_suite_name() + "_" + info->name() + "_" +
+               std::to_string(getpid());
+    }
+};
+
+} // namespace Util
@@ -0,0 +1,153 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <algorithm>
+
+#include "thread_pool.hpp"
+
+namespace Util {
+
+namespace {
+
+/// The pool the current thread is a worker of, if any
+thread_local const ThreadPool * current_pool = nullptr;
+
+/// The index of the current thread's queue in it's pool
+thread_local std::size_t current_index = 0;
+
+std::size_t jobs = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(std::size_t workers) {
+    workers = std::max<std::size_t>(workers, 1);
+    for (std::size_t i = 0; i < workers; ++i) {
+        queues.emplace_back(std::make_unique<Queue>());
+    }
+    for (std::size_t i = 0; i < workers; ++i) {
+        threads.emplace_back(&ThreadPool::worker, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard l{sleep_lock};
+        done = true;
+    }
+    sleep_cv.notify_all();
+    for (auto & t : threads) {
+        t.join();
+    }
+}
+
+std::size_t ThreadPool::size() const { return threads.size(); }
+
+void ThreadPool::push(Job && job) {
+    // Jobs created by a worker are likely to be related to what that worker is
+    // doing, so keep them local, otherwise spread them around
+    const std::size_t index =
+        current_pool == this ? current_index : next_queue++ % queues.size();
+    // Count the job before it's visible, so that pending never underflows
+    {
+        std::lock_guard l{sleep_lock};
+        ++pending;
+    }
+    {
+        std::lock_guard l{queues[index]->lock};
+        queues[index]->jobs.emplace_front(std::move(job));
+    }
+    sleep_cv.notify_one();
+    wait_cv.notify_all();
+}
+
+bool ThreadPool::pop(std::size_t index, Job & job) {
+    auto & q = *queues[index];
+    std::lock_guard l{q.lock};
+    if (q.jobs.empty()) {
+        return false;
+    }
+    job = std::move(q.jobs.front());
+    q.jobs.pop_front();
+    --pending;
+    return true;
+}
+
+bool ThreadPool::steal(std::size_t index, Job & job) {
+    for (std::size_t i = 1; i < queues.size(); ++i) {
+        auto & q = *queues[(index + i) % queues.size()];
+        std::lock_guard l{q.lock};
+        if (!q.jobs.empty()) {
+            job = std::move(q.jobs.back());
+            q.jobs.pop_back();
+            --pending;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::run_one() {
+    const std::size_t index = current_pool == this ? current_index : 0;
+    Job job;
+    if (pop(index, job) || steal(index, job)) {
+        job();
+        // The job may have finished a future that someone is waiting on. Take
+        // the lock so that the notification can't land between a waiter
+        // checking the future and going to sleep.
+        {
+            std::lock_guard l{sleep_lock};
+        }
+        wait_cv.notify_all();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::worker(std::size_t index) {
+    current_pool = this;
+    current_index = index;
+
+    while (true) {
+        if (run_one()) {
+            continue;
+        }
+
+        std::unique_lock l{sleep_lock};
+        sleep_cv.wait(l, [this] { return done || pending > 0; });
+        if (done && pending == 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::chain(Continuations & prev, Job && job) {
+    {
+        std::lock_guard l{prev.lock};
+        if (!prev.finished) {
+            prev.jobs.emplace_back(std::move(job));
+            return;
+        }
+    }
+    push(std::move(job));
+}
+
+void ThreadPool::finish(Continuations & c) {
+    std::vector<Job> ready{};
+    {
+        std::lock_guard l{c.lock};
+        c.finished = true;
+        ready.swap(c.jobs);
+    }
+    for (auto & job : ready) {
+        push(std::move(job));
+    }
+}
+
+void set_jobs(std::size_t j) { jobs = j; }
+
+ThreadPool & pool() {
+    static ThreadPool p{jobs ? jobs : std::thread::hardware_concurrency()};
+    return p;
+}
+
+} // namespace Util
@@ -0,0 +1,252 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+/**
+ * A work stealing thread pool for configure time jobs
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Util {
+
+template <typename T> class Task;
+
+/**
+ * A pool of worker threads
+ *
+ * Each worker has it's own queue of jobs. Jobs submitted from a worker go onto
+ * that worker's queue, jobs submitted from anywhere else are spread across the
+ * queues. When a worker runs out of jobs in it's own queue it steals them from
+ * the back of the other worker's queues.
+ *
+ * Jobs may wait on the results of other jobs, but must do so with `wait()`,
+ * which runs other jobs while waiting, so that the pool cannot deadlock with
+ * every worker waiting on jobs that are still queued. A job that only needs
+ * the result of another can instead be chained on with `then()`, which doesn't
+ * queue it until the result is ready.
+ */
+class ThreadPool {
+  public:
+    /// Create a pool with the given number of workers, at least one
+    explicit ThreadPool(std::size_t workers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+
+    /// The number of worker threads
+    std::size_t size() const;
+
+    /// Submit a job to be run, returns a future with the result
+    template <typename F> std::future<std::invoke_result_t<F>> submit(F && func) {
+        using R = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(func));
+        auto future = task->get_future();
+        push([task]() { (*task)(); });
+        return future;
+    }
+
+    /// Submit a job to be run, returns a Task that other jobs can be chained onto
+    template <typename F> Task<std::invoke_result_t<F>> submit_task(F && func) {
+        using R = std::invoke_result_t<F>;
+        auto state = std::make_shared<typename Task<R>::State>();
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(func));
+        state->future = task->get_future().share();
+        push([this, task, state]() {
+            (*task)();
+            finish(*state);
+        });
+        return Task<R>{std::move(state)};
+    }
+
+    /**
+     * Run a job with the result of another once it has finished
+     *
+     * The job is attached to `prev`, and is only pushed onto a queue when
+     * `prev` finishes, so it never holds a worker while `prev` runs. If `prev`
+     * threw, the exception is passed on to the returned Task without calling
+     * func.
+     */
+    template <typename T, typename F> auto then(const Task<T> & prev, F && func) {
+        using R = typename Continuation<F, T>::type;
+        auto state = std::make_shared<typename Task<R>::State>();
+        auto task = std::make_shared<std::packaged_task<R()>>(
+            [prev = prev.future(), func = std::forward<F>(func)]() mutable {
+                if constexpr (std::is_void_v<T>) {
+                    prev.get();
+                    return func();
+                } else {
+                    return func(prev.get());
+                }
+            });
+        state->future = task->get_future().share();
+        chain(*prev.state, [this, task, state]() {
+            (*task)();
+            finish(*state);
+        });
+        return Task<R>{std::move(state)};
+    }
+
+    /**
+     * Call func(i) for every i in [0, count), spread across the pool
+     *
+     * The calling thread takes part as well. If any call throws, the exception
+     * from the lowest i is rethrown once every call has finished, which is the
+     * one that a serial loop would have thrown.
+     */
+    template <typename F> void parallel_for(std::size_t count, F && func) {
+        std::atomic_size_t next{0};
+        std::vector<std::exception_ptr> errors(count);
+
+        const auto worker = [&]() {
+            for (std::size_t i = next++; i < count; i = next++) {
+                try {
+                    func(i);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::future<void>> futures{};
+        for (std::size_t i = 1; i < std::min(size(), count); ++i) {
+            futures.emplace_back(submit(worker));
+        }
+        worker();
+        for (auto & f : futures) {
+            wait(f);
+        }
+
+        for (const auto & e : errors) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        }
+    }
+
+    /**
+     * Wait for a future from a job in this pool, running other jobs while
+     * waiting
+     *
+     * When there is nothing to run this sleeps until a job is pushed or
+     * finishes. This is safe to call both from worker threads and from
+     * outside the pool.
+     */
+    template <typename Fut> void wait(const Fut & future) {
+        const auto ready = [&future]() {
+            return future.wait_for(std::chrono::seconds{0}) == std::future_status::ready;
+        };
+        while (!ready()) {
+            if (run_one()) {
+                continue;
+            }
+            std::unique_lock l{sleep_lock};
+            wait_cv.wait(l, [&]() { return pending > 0 || ready(); });
+        }
+    }
+
+  private:
+    template <typename T> friend class Task;
+
+    using Job = std::function<void()>;
+
+    /// The result type of a job chained onto a job returning T
+    template <typename F, typename T> struct Continuation {
+        using type = std::invoke_result_t<F, const T &>;
+    };
+    template <typename F> struct Continuation<F, void> {
+        using type = std::invoke_result_t<F>;
+    };
+
+    /// The jobs chained onto another job, pushed when it finishes
+    struct Continuations {
+        std::mutex lock;
+        bool finished = false;
+        std::vector<Job> jobs;
+    };
+
+    struct Queue {
+        std::mutex lock;
+        std::deque<Job> jobs;
+    };
+
+    void push(Job && job);
+    bool pop(std::size_t index, Job & job);
+    bool steal(std::size_t index, Job & job);
+    bool run_one();
+    void worker(std::size_t index);
+    void chain(Continuations & prev, Job && job);
+    void finish(Continuations & c);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    /// Used to put idle workers to sleep
+    std::mutex sleep_lock;
+    std::condition_variable sleep_cv;
+
+    /// Used to wake threads in `wait()`, shares `sleep_lock`
+    std::condition_variable wait_cv;
+
+    /// The number of jobs that have been pushed but not started
+    std::atomic_size_t pending{0};
+
+    /// The next queue to put a job from outside the pool on
+    std::atomic_size_t next_queue{0};
+
+    std::atomic_bool done{false};
+};
+
+/**
+ * The result of a job, which other jobs can be chained onto
+ *
+ * Created by `ThreadPool::submit_task` and `ThreadPool::then`.
+ */
+template <typename T> class Task {
+  public:
+    /// The result of the job
+    const std::shared_future<T> & future() const { return state->future; }
+
+  private:
+    friend class ThreadPool;
+
+    struct State : ThreadPool::Continuations {
+        std::shared_future<T> future;
+    };
+
+    explicit Task(std::shared_ptr<State> s) : state{std::move(s)} {}
+
+    std::shared_ptr<State> state;
+};
+
+/**
+ * Set the number of workers in the process wide pool
+ *
+ * Must be called before the first call to `pool()`, 0 means use the number of
+ * hardware threads.
+ */
+void set_jobs(std::size_t jobs);
+
+/**
+ * Get the process wide pool
+ *
+ * The pool is created the first time this is called, and shared by everything
+ * in the process.
+ */
+ThreadPool & pool();
+
+} // namespace Util
@@ -0,0 +1,139 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+TEST(thread_pool, submit) {
+    Util::ThreadPool pool{4};
+    auto f = pool.submit([]() { return 42; });
+    pool.wait(f);
+    ASSERT_EQ(f.get(), 42);
+}
+
+TEST(thread_pool, many_jobs) {
+    Util::ThreadPool pool{4};
+    std::atomic_int count{0};
+    std::vector<std::future<void>> futures{};
+    for (int i = 0; i < 1000; ++i) {
+        futures.emplace_back(pool.submit([&count]() { ++count; }));
+    }
+    for (auto & f : futures) {
+        pool.wait(f);
+    }
+    ASSERT_EQ(count, 1000);
+}
+
+TEST(thread_pool, exception) {
+    Util::ThreadPool pool{2};
+    auto f = pool.submit([]() -> int { throw std::runtime_error{"oops"}; });
+    pool.wait(f);
+    ASSERT_THROW(f.get(), std::runtime_error);
+}
+
+TEST(thread_pool, then) {
+    Util::ThreadPool pool{2};
+    auto first = pool.submit_task([]() { return 20; });
+    auto second = pool.then(first, [](int v) { return v + 1; });
+    pool.wait(second.future());
+    ASSERT_EQ(second.future().get(), 21);
+}
+
+TEST(thread_pool, then_not_queued_early) {
+    // The continuation is attached to the first job rather than queued, so
+    // with a single worker that is busy it has nothing else to run
+    Util::ThreadPool pool{1};
+    std::promise<void> gate{};
+    auto first = pool.submit_task([opened = gate.get_future().share()]() {
+        opened.wait();
+        return 1;
+    });
+    std::atomic_bool ran{false};
+    auto second = pool.then(first, [&ran](int v) {
+        ran = true;
+        return v + 1;
+    });
+    auto third = pool.then(second, [](int v) { return v * 10; });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    ASSERT_FALSE(ran);
+
+    gate.set_value();
+    pool.wait(third.future());
+    ASSERT_TRUE(ran);
+    ASSERT_EQ(third.future().get(), 20);
+}
+
+TEST(thread_pool, then_long_chain) {
+    // Each link is only queued once the previous one is done, so a long chain
+    // doesn't nest waits inside each other
+    Util::ThreadPool pool{1};
+    auto task = pool.submit_task([]() { return 0; });
+    for (int i = 0; i < 10000; ++i) {
+        task = pool.then(task, [](int v) { return v + 1; });
+    }
+    pool.wait(task.future());
+    ASSERT_EQ(task.future().get(), 10000);
+}
+
+TEST(thread_pool, then_exception) {
+    Util::ThreadPool pool{2};
+    std::atomic_bool called{false};
+    auto first = pool.submit_task([]() -> int { throw std::runtime_error{"oops"}; });
+    auto second = pool.then(first, [&called](int) { called = true; });
+    pool.wait(second.future());
+    ASSERT_THROW(second.future().get(), std::runtime_error);
+    ASSERT_FALSE(called);
+}
+
+TEST(thread_pool, nested_wait) {
+    // With a single worker, a job waiting on a job it submitted must run that
+    // job itself rather than deadlocking.
+    Util::ThreadPool pool{1};
+    auto outer = pool.submit([&pool]() {
+        std::vector<std::future<int>> inner{};
+        for (int i = 0; i < 10; ++i) {
+            inner.emplace_back(pool.submit([i]() { return i; }));
+        }
+        int sum = 0;
+        for (auto & f : inner) {
+            pool.wait(f);
+            sum += f.get();
+        }
+        return sum;
+    });
+    pool.wait(outer);
+    ASSERT_EQ(outer.get(), 45);
+}
+
+TEST(thread_pool, parallel_for) {
+    Util::ThreadPool pool{4};
+    std::vector<int> out(1000, 0);
+    pool.parallel_for(out.size(), [&out](std::size_t i) { out[i] = static_cast<int>(i); });
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        ASSERT_EQ(out[i], i);
+    }
+}
+
+TEST(thread_pool, parallel_for_exception) {
+    // The first error is reported, like a loop would
+    Util::ThreadPool pool{4};
+    try {
+        pool.parallel_for(100, [](std::size_t i) {
+            if (i % 10 == 5) {
+                throw std::runtime_error{std::to_string(i)};
+            }
+        });
+        FAIL();
+    } catch (const std::runtime_error & e) {
+        ASSERT_EQ(std::string{e.what()}, "5");
+    }
+}
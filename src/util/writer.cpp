@@ -0,0 +1,221 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "exceptions.hpp"
+#include "writer.hpp"
+
+namespace Util {
+
+namespace {
+
+/// Read exactly size bytes at offset, unless the end of the file is reached first
+std::size_t pread_all(int fd, char * buf, std::size_t size, off_t offset) {
+    std::size_t done = 0;
+    while (done < size) {
+        const ssize_t count = pread(fd, buf + done, size - done, offset + done);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        } else if (count <= 0) {
+            break;
+        }
+        done += count;
+    }
+    return done;
+}
+
+bool write_all(int fd, const char * buf, std::size_t size) {
+    while (size > 0) {
+        const ssize_t count = ::write(fd, buf, size);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buf += count;
+        size -= count;
+    }
+    return true;
+}
+
+} // namespace
+
+FileWriter::FileWriter(const std::filesystem::path & file_)
+    : file{file_}, tmp{std::filesystem::path{file_}.concat(".tmp")},
+      old_fd{open(file_.c_str(), O_RDONLY | O_CLOEXEC)} {
+    blocks.emplace_back(std::make_unique<Block>());
+    if (old_fd < 0) {
+        // Nothing to compare to, so this is a new file
+        diverge();
+    } else {
+        scratch = std::make_unique<Block>();
+    }
+}
+
+FileWriter::~FileWriter() {
+    if (old_fd >= 0) {
+        close(old_fd);
+    }
+    if (fd >= 0) {
+        close(fd);
+        unlink(tmp.c_str());
+    }
+}
+
+FileWriter & FileWriter::operator<<(std::string_view str) {
+    append(str.data(), str.size());
+    return *this;
+}
+
+FileWriter & FileWriter::operator<<(char c) {
+    if (used == BLOCK_SIZE) {
+        append(&c, 1);
+    } else {
+        (*blocks[current])[used++] = c;
+    }
+    return *this;
+}
+
+void FileWriter::append(const char * data, std::size_t size) {
+    while (size > 0) {
+        if (used == BLOCK_SIZE) {
+            if (current + 1 == MAX_BLOCKS) {
+                flush();
+            } else {
+                if (++current == blocks.size()) {
+                    blocks.emplace_back(std::make_unique<Block>());
+                }
+                used = 0;
+            }
+        }
+        const std::size_t count = std::min(size, BLOCK_SIZE - used);
+        std::memcpy(blocks[current]->data() + used, data, count);
+        used += count;
+        data += count;
+        size -= count;
+    }
+}
+
+bool FileWriter::matches() {
+    std::size_t offset = matched;
+    for (std::size_t i = 0; i <= current; ++i) {
+        const std::size_t size = i == current ? used : BLOCK_SIZE;
+        if (pread_all(old_fd, scratch->data(), size, offset) != size ||
+            std::memcmp(scratch->data(), blocks[i]->data(), size) != 0) {
+            return false;
+        }
+        offset += size;
+    }
+    matched = offset;
+    return true;
+}
+
+void FileWriter::diverge() {
+    fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        fail("create");
+    }
+
+    // Start with the part that was the same as the old file
+    for (std::size_t offset = 0; offset < matched;) {
+        const std::size_t size = std::min(BLOCK_SIZE, matched - offset);
+        if (pread_all(old_fd, scratch->data(), size, offset) != size) {
+            fail("read");
+        }
+        if (!write_all(fd, scratch->data(), size)) {
+            fail("write");
+        }
+        offset += size;
+    }
+
+    if (old_fd >= 0) {
+        close(old_fd);
+        old_fd = -1;
+    }
+}
+
+void FileWriter::flush() {
+    if (fd < 0) {
+        if (matches()) {
+            current = 0;
+            used = 0;
+            return;
+        }
+        diverge();
+    }
+
+    std::array<iovec, MAX_BLOCKS> iov;
+    for (std::size_t i = 0; i <= current; ++i) {
+        iov[i].iov_base = blocks[i]->data();
+        iov[i].iov_len = i == current ? used : BLOCK_SIZE;
+    }
+
+    // writev may write less than it was asked to, so keep going from where it
+    // stopped
+    iovec * next = iov.data();
+    std::size_t left = current + 1;
+    while (left > 0) {
+        const ssize_t written = writev(fd, next, static_cast<int>(left));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fail("write");
+        }
+        auto count = static_cast<std::size_t>(written);
+        while (left > 0 && count >= next->iov_len) {
+            count -= next->iov_len;
+            ++next;
+            --left;
+        }
+        if (left > 0) {
+            next->iov_base = static_cast<char *>(next->iov_base) + count;
+            next->iov_len -= count;
+        }
+    }
+
+    current = 0;
+    used = 0;
+}
+
+bool FileWriter::commit() {
+    flush();
+
+    // All of the output matched, so as long as the old file doesn't have
+    // anything more it's the same
+    if (fd < 0) {
+        struct stat st;
+        if (fstat(old_fd, &st) == 0 && static_cast<std::size_t>(st.st_size) == matched) {
+            close(old_fd);
+            old_fd = -1;
+            return false;
+        }
+        diverge();
+    }
+
+    const int closed = close(fd);
+    fd = -1;
+    if (closed != 0 || rename(tmp.c_str(), file.c_str()) != 0) {
+        const int err = errno;
+        unlink(tmp.c_str());
+        errno = err;
+        fail(closed != 0 ? "write" : "replace");
+    }
+    return true;
+}
+
+void FileWriter::fail(const std::string & what) const {
+    throw Exceptions::MesonException{"Could not " + what + " " + file.string() + ": " +
+                                     std::strerror(errno)};
+}
+
+} // namespace Util
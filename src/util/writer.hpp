@@ -0,0 +1,94 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+/**
+ * Buffered writing of generated files
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Util {
+
+/**
+ * Writes a file through a large buffer, replacing the old file atomically
+ *
+ * Output is appended to a list of fixed size blocks, which are handed to the
+ * kernel together with a single `writev` once they're all full, so there's no
+ * flushing per line like `std::endl` does. Everything is written to
+ * `<file>.tmp`, which is renamed over the file by `commit`. If the writer is
+ * destroyed without being committed (because generation failed part way) the
+ * temporary is removed, and the old file is left untouched.
+ *
+ * Files are only replaced if their contents change. Each batch of blocks is
+ * compared to the same range of the existing file instead of being written,
+ * and only once they differ is the temporary created, starting with the
+ * matching part of the old file. Regenerating an unchanged file writes
+ * nothing, and leaves it's mtime alone, so tools like ninja that watch it
+ * don't see a change.
+ */
+class FileWriter {
+  public:
+    /// Start writing a replacement for file, throws if it cannot be created
+    explicit FileWriter(const std::filesystem::path & file);
+
+    /// Throws away anything written, unless `commit` has been called
+    ~FileWriter();
+
+    FileWriter(const FileWriter &) = delete;
+    FileWriter & operator=(const FileWriter &) = delete;
+
+    FileWriter & operator<<(std::string_view);
+    FileWriter & operator<<(char);
+
+    /**
+     * Write anything still buffered, and replace the file
+     *
+     * @return false if the file already had the same contents, and was left alone
+     */
+    bool commit();
+
+  private:
+    static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+    /// Blocks buffered before they're written, 1MiB
+    static constexpr std::size_t MAX_BLOCKS = 16;
+
+    using Block = std::array<char, BLOCK_SIZE>;
+
+    void append(const char * data, std::size_t size);
+    void flush();
+    bool matches();
+    void diverge();
+    [[noreturn]] void fail(const std::string & what) const;
+
+    const std::filesystem::path file;
+    const std::filesystem::path tmp;
+
+    /// The temporary, -1 until the output differs from the old file
+    int fd = -1;
+
+    /// The old file, -1 once the output differs from it, or if there isn't one
+    int old_fd;
+
+    /// How much of the output has been found to be the same as the old file
+    std::size_t matched = 0;
+
+    std::vector<std::unique_ptr<Block>> blocks;
+
+    /// Used to read the old file for comparison
+    std::unique_ptr<Block> scratch;
+
+    /// The block being filled, and how much of it is used
+    std::size_t current = 0;
+    std::size_t used = 0;
+};
+
+} // namespace Util
@@ -0,0 +1,113 @@
+// SPDX-license-identifier: Apache-2.0
+// Copyright © 2022 Dylan Baker
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "exceptions.hpp"
+#include "test_directory.hpp"
+#include "writer.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+class FileWriterTest : public ::testing::Test {
+  protected:
+    std::string read(const fs::path & p) const {
+        std::ifstream in{p};
+        std::stringstream ss{};
+        ss << in.rdbuf();
+        return ss.str();
+    }
+
+    const Util::TestDirectory tmp{};
+    const fs::path & root = tmp.path;
+};
+
+/// Enough to fill the buffer several times, with writes that cross blocks
+std::string write_large(const fs::path & file, int changed_at = -1) {
+    std::string expected{};
+    Util::FileWriter out{file};
+    for (int i = 0; i < 200000; ++i) {
+        const std::string line = "build obj" + std::to_string(i) + ".o: cc src.c" +
+                                 (i >= changed_at && changed_at >= 0 ? " changed" : "") + "\n";
+        out << line;
+        expected.append(line);
+        if (i % 1000 == 0) {
+            const std::string big(100000, 'x');
+            out << big << '\n';
+            expected.append(big).push_back('\n');
+        }
+    }
+    out.commit();
+    return expected;
+}
+
+} // namespace
+
+TEST_F(FileWriterTest, simple) {
+    {
+        Util::FileWriter out{root / "file"};
+        out << "build a: rule b" << '\n' << std::string{"  ARGS = c"} << '\n';
+        out.commit();
+    }
+    ASSERT_EQ(read(root / "file"), "build a: rule b\n  ARGS = c\n");
+    ASSERT_FALSE(fs::exists(root / "file.tmp"));
+}
+
+TEST_F(FileWriterTest, large) {
+    const auto expected = write_large(root / "file");
+    ASSERT_EQ(read(root / "file"), expected);
+}
+
+TEST_F(FileWriterTest, unchanged) {
+    write_large(root / "file");
+    const auto old = fs::last_write_time(root / "file") - std::chrono::hours{1};
+    fs::last_write_time(root / "file", old);
+
+    write_large(root / "file");
+    ASSERT_EQ(fs::last_write_time(root / "file"), old);
+    ASSERT_FALSE(fs::exists(root / "file.tmp"));
+}
+
+TEST_F(FileWriterTest, changed_part_way) {
+    write_large(root / "file");
+    // After several MiB have already been found to be the same
+    const auto expected = write_large(root / "file", 150000);
+    ASSERT_EQ(read(root / "file"), expected);
+}
+
+TEST_F(FileWriterTest, old_file_longer) {
+    std::ofstream{root / "file"} << "abc\n";
+    Util::FileWriter out{root / "file"};
+    out << "abc";
+    ASSERT_TRUE(out.commit());
+    ASSERT_EQ(read(root / "file"), "abc");
+}
+
+TEST_F(FileWriterTest, old_file_shorter) {
+    std::ofstream{root / "file"} << "abc";
+    Util::FileWriter out{root / "file"};
+    out << "abc\n";
+    ASSERT_TRUE(out.commit());
+    ASSERT_EQ(read(root / "file"), "abc\n");
+}
+
+TEST_F(FileWriterTest, not_committed) {
+    std::ofstream{root / "file"} << "old";
+    {
+        Util::FileWriter out{root / "file"};
+        out << "new";
+    }
+    ASSERT_EQ(read(root / "file"), "old");
+    ASSERT_FALSE(fs::exists(root / "file.tmp"));
+}
+
+TEST_F(FileWriterTest, cannot_create) {
+    ASSERT_THROW(Util::FileWriter{root / "missing" / "file"}, Util::Exceptions::MesonException);
+}